@@ -6,15 +6,38 @@
 #include <string>
 #include <algorithm>
 #include <limits>
+#include <stdexcept>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <sstream>
+#include <mutex>
+#include <exception>
+#include <queue>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+#include "trajectory_file.h"
+#include "../Seminars/Seminar 7/gnuplot_pipe.h"
 
 using namespace std;
 
 const double M_PI = 3.14159265358979323846;
 
-// ========== CONSTANTS FOR TU-134 ==========
-const double TU134_MASS = 47000.0; // kg
-const double TU134_WING_AREA = 127.0; // m²
-const double TU134_NOMINAL_THRUST = 2 * 68000.0; // N (2x D-30 engines)
+// ========== MISSION CONSTANTS ==========
 const double MAX_THRUST_PERCENT = 1.0; // 100% thrust
 const double INITIAL_ALTITUDE = 300.0; // m
 const double FINAL_ALTITUDE = 6000.0; // m
@@ -22,16 +45,10 @@ const double INITIAL_VELOCITY = 310.0 / 3.6; // m/s (310 km/h)
 const double FINAL_VELOCITY = 700.0 / 3.6; // m/s (700 km/h)
 const double GRAVITY = 9.81; // m/s²
 
-// Aerodynamic coefficients
-const double Cx0 = 0.022; // Zero-lift drag coefficient
-const double K = 0.045; // Induced drag factor
-const double Cl_alpha = 5.2; // Lift curve slope (per radian)
-const double Cy_max = 1.4; // Maximum lift coefficient
-const double Cp = 0.6 / 9.81; // Specific fuel consumption (kg/(N·h)) - CORRECTED!
-const double phi_p = 2.0 * M_PI / 180.0; // Engine inclination
-
 // Grid parameters
-const int N = 30; // Number of grid points
+const int DEFAULT_GRID_SIZE = 30; // Default number of grid steps per axis
+const long long MAX_GRID_NODES = 50000000; // ~1.6 GB of state grid
+const int WAVEFRONT_MIN_SIZE = 64; // Smaller grids are swept on one thread
 const double MAX_VERTICAL_SPEED = 8.0; // m/s
 const double MAX_CLIMB_ANGLE = 15.0 * M_PI / 180.0; // radians
 const double MIN_CLIMB_SPEED = 300.0 / 3.6; // m/s
@@ -49,6 +66,310 @@ enum ManeuverType {
     COMBINED = 3
 };
 
+// ========== AIRCRAFT MODELS ==========
+// Each aircraft is a policy type with compile-time parameters. The segment
+// rows are prepared by templates over the policy, so every type gets its own
+// instantiation with the constants folded in.
+struct Tu134 {
+    static constexpr double mass = 47000.0; // kg
+    static constexpr double wing_area = 127.0; // m²
+    static constexpr double nominal_thrust = 2 * 68000.0; // N (2x D-30 engines)
+    static constexpr double Cx0 = 0.022; // Zero-lift drag coefficient
+    static constexpr double K = 0.045; // Induced drag factor
+    static constexpr double Cl_alpha = 5.2; // Lift curve slope (per radian)
+    static constexpr double Cy_max = 1.4; // Maximum lift coefficient
+    static constexpr double Cp = 0.6 / 9.81; // Specific fuel consumption (kg/(N·h)) - CORRECTED!
+    static constexpr double engine_angle = 2.0; // Engine inclination, degrees
+};
+
+// Approximate data for comparison runs
+struct Tu154 {
+    static constexpr double mass = 90000.0; // kg
+    static constexpr double wing_area = 201.45; // m²
+    static constexpr double nominal_thrust = 3 * 103000.0; // N (3x D-30KU-154)
+    static constexpr double Cx0 = 0.020;
+    static constexpr double K = 0.048;
+    static constexpr double Cl_alpha = 5.0;
+    static constexpr double Cy_max = 1.5;
+    static constexpr double Cp = 0.62 / 9.81;
+    static constexpr double engine_angle = 2.0;
+};
+
+struct Yak42 {
+    static constexpr double mass = 54000.0; // kg
+    static constexpr double wing_area = 150.0; // m²
+    static constexpr double nominal_thrust = 3 * 63700.0; // N (3x D-36)
+    static constexpr double Cx0 = 0.021;
+    static constexpr double K = 0.043;
+    static constexpr double Cl_alpha = 5.3;
+    static constexpr double Cy_max = 1.45;
+    static constexpr double Cp = 0.65 / 9.81;
+    static constexpr double engine_angle = 2.0;
+};
+
+// Registry ids of the built-in types; types loaded from files follow them
+enum AircraftType {
+    AIRCRAFT_TU134 = 0,
+    AIRCRAFT_TU154 = 1,
+    AIRCRAFT_YAK42 = 2
+};
+
+const int MAX_AIRCRAFT_MODELS = 64;
+
+// Runtime parameter block with the same members as the policy types, so the
+// aerodynamic templates accept either. Aligned to cache lines: the blocks are
+// written once at startup and then only read by the solver threads.
+struct alignas(64) AircraftModel {
+    double mass;
+    double wing_area;
+    double nominal_thrust;
+    double Cx0;
+    double K;
+    double Cl_alpha;
+    double Cy_max;
+    double Cp;
+    double engine_angle;
+
+    AircraftModel() : mass(0), wing_area(0), nominal_thrust(0), Cx0(0), K(0), Cl_alpha(0),
+                      Cy_max(0), Cp(0), engine_angle(0) {}
+
+    template <class Aircraft>
+    static AircraftModel from(const Aircraft& aircraft) {
+        AircraftModel model;
+        model.mass = aircraft.mass;
+        model.wing_area = aircraft.wing_area;
+        model.nominal_thrust = aircraft.nominal_thrust;
+        model.Cx0 = aircraft.Cx0;
+        model.K = aircraft.K;
+        model.Cl_alpha = aircraft.Cl_alpha;
+        model.Cy_max = aircraft.Cy_max;
+        model.Cp = aircraft.Cp;
+        model.engine_angle = aircraft.engine_angle;
+        return model;
+    }
+};
+
+// Aircraft types by name: the built-in policies plus the types loaded with
+// loadFromFile. Files are loaded before any solve starts; after that the
+// registry is only read, so the solver threads share it without locking.
+class AircraftRegistry {
+private:
+    AircraftModel models[MAX_AIRCRAFT_MODELS];
+    string names[MAX_AIRCRAFT_MODELS];
+    int count;
+
+public:
+    AircraftRegistry() : count(0) {
+        add("tu134", AircraftModel::from(Tu134()));
+        add("tu154", AircraftModel::from(Tu154()));
+        add("yak42", AircraftModel::from(Yak42()));
+    }
+
+    int size() const { return count; }
+    const AircraftModel& model(int id) const { return models[id]; }
+    const string& name(int id) const { return names[id]; }
+
+    // -1 if there is no such type
+    int find(const string& name) const {
+        for (int id = 0; id < count; id++) {
+            if (names[id] == name) return id;
+        }
+        return -1;
+    }
+
+    int add(const string& name, const AircraftModel& model) {
+        if (name.empty()) throw invalid_argument("aircraft type without a name");
+        if (find(name) >= 0) throw invalid_argument("aircraft '" + name + "' is already defined");
+        if (count == MAX_AIRCRAFT_MODELS) throw invalid_argument("too many aircraft types");
+        if (!(model.mass > 0) || !(model.wing_area > 0) || !(model.nominal_thrust > 0) ||
+            !(model.Cl_alpha > 0) || !(model.Cy_max > 0) || !(model.Cp > 0) ||
+            !(model.Cx0 >= 0) || !(model.K >= 0)) {
+            throw invalid_argument("aircraft '" + name + "' has non-physical parameters");
+        }
+        models[count] = model;
+        names[count] = name;
+        return count++;
+    }
+
+    // key=value lines as in the Seminar 6 aircraft loader; '#' starts a comment.
+    // Every "name=" line starts a new type, which must set all the parameters.
+    void loadFromFile(const string& filename) {
+        ifstream fin(filename);
+        if (!fin.is_open()) throw runtime_error("cannot open aircraft file " + filename);
+
+        const char* const keys[] = {"mass", "wing_area", "nominal_thrust", "Cx0", "K", "Cl_alpha",
+                                    "Cy_max", "Cp", "engine_angle"};
+        const int key_count = sizeof(keys) / sizeof(keys[0]);
+
+        string name;
+        double values[key_count];
+        bool seen[key_count];
+        int line_number = 0;
+
+        auto finish = [&]() {
+            if (name.empty()) return;
+            for (int k = 0; k < key_count; k++) {
+                if (!seen[k]) {
+                    throw invalid_argument(filename + ": aircraft '" + name + "' has no " + keys[k]);
+                }
+            }
+            AircraftModel model;
+            model.mass = values[0];
+            model.wing_area = values[1];
+            model.nominal_thrust = values[2];
+            model.Cx0 = values[3];
+            model.K = values[4];
+            model.Cl_alpha = values[5];
+            model.Cy_max = values[6];
+            model.Cp = values[7];
+            model.engine_angle = values[8];
+            add(name, model);
+        };
+
+        string line;
+        while (getline(fin, line)) {
+            line_number++;
+            line = line.substr(0, line.find('#'));
+            size_t eq_pos = line.find('=');
+            if (line.find_first_not_of(" \t\r") == string::npos) continue;
+            string where = filename + ":" + to_string(line_number);
+            if (eq_pos == string::npos) throw invalid_argument(where + ": expected key=value");
+
+            string key = line.substr(0, eq_pos);
+            string value = line.substr(eq_pos + 1);
+            key.erase(0, key.find_first_not_of(" \t"));
+            key.erase(key.find_last_not_of(" \t") + 1);
+            value.erase(0, value.find_first_not_of(" \t"));
+            value.erase(value.find_last_not_of(" \t\r") + 1);
+
+            if (key == "name") {
+                finish();
+                name = value;
+                fill(begin(seen), end(seen), false);
+                continue;
+            }
+            if (name.empty()) throw invalid_argument(where + ": parameters before the first name=");
+
+            int k = (int)(std::find(keys, keys + key_count, key) - keys);
+            if (k == key_count) throw invalid_argument(where + ": unknown parameter '" + key + "'");
+
+            size_t used = 0;
+            try {
+                values[k] = stod(value, &used);
+            } catch (const exception&) {
+                used = 0;
+            }
+            if (used == 0 || used != value.size()) {
+                throw invalid_argument(where + ": bad number '" + value + "'");
+            }
+            seen[k] = true;
+        }
+        finish();
+    }
+};
+
+AircraftRegistry& aircraft_registry() {
+    static AircraftRegistry registry;
+    return registry;
+}
+
+const char* aircraft_name(int id) {
+    return aircraft_registry().name(id).c_str();
+}
+
+// Registry id of the type; throws on an unknown name
+int parse_aircraft(const string& name) {
+    int id = aircraft_registry().find(name);
+    if (id < 0) throw invalid_argument("unknown aircraft '" + name + "'");
+    return id;
+}
+
+double aircraft_mass(int id) {
+    return aircraft_registry().model(id).mass;
+}
+
+// Boundary conditions, loading and grid resolution of one solve. The
+// defaults are the constants above.
+struct Scenario {
+    double initial_altitude; // m
+    double final_altitude;   // m
+    double initial_velocity; // m/s
+    double final_velocity;   // m/s
+    int aircraft;            // aircraft registry id
+    double takeoff_mass;     // kg, 0 takes the aircraft's default
+    double thrust_fraction;  // share of the nominal thrust available
+    int NH;                  // altitude steps
+    int NV;                  // velocity steps
+    double mass_step;        // kg of fuel per mass bucket, 0 keeps one mass per node
+    int refine;              // coarse-to-fine factor per level, 0 solves the full grid
+    bool best_first;         // A* search from the start instead of a full sweep
+    int jump;                // longest combined move, in grid steps (1 = unit steps)
+    bool optimal_controls;   // search angle of attack and throttle per edge
+
+    Scenario() : initial_altitude(INITIAL_ALTITUDE), final_altitude(FINAL_ALTITUDE),
+                 initial_velocity(INITIAL_VELOCITY), final_velocity(FINAL_VELOCITY),
+                 aircraft(AIRCRAFT_TU134), takeoff_mass(0), thrust_fraction(MAX_THRUST_PERCENT),
+                 NH(DEFAULT_GRID_SIZE), NV(DEFAULT_GRID_SIZE), mass_step(0),
+                 refine(0), best_first(false), jump(1), optimal_controls(false) {}
+
+    double stepH() const { return (final_altitude - initial_altitude) / NH; }
+    double stepV() const { return (final_velocity - initial_velocity) / NV; }
+    long long nodeCount() const { return (long long)(NH + 1) * (NV + 1); }
+    double takeoffMass() const { return takeoff_mass > 0 ? takeoff_mass : aircraft_mass(aircraft); }
+    double massFloor() const { return takeoffMass() * 0.85; }
+    // One mass per node, full grid, unit steps and scheduled controls
+    bool plainGrid() const {
+        return mass_step == 0 && refine <= 1 && !best_first && jump == 1 && !optimal_controls;
+    }
+
+    void validate() const {
+        // Corridor solves never allocate the full grid, only index it
+        long long max_nodes = refine > 1 ? (long long)numeric_limits<int>::max() : MAX_GRID_NODES;
+        if (NH < 1 || NV < 1 || nodeCount() > max_nodes) {
+            throw invalid_argument("grid size " + to_string(NH) + " x " + to_string(NV)
+                                   + " is out of range");
+        }
+        if (!(final_altitude > initial_altitude) || !(final_velocity > initial_velocity)) {
+            throw invalid_argument("final altitude and velocity must exceed the initial ones");
+        }
+        if (!(takeoff_mass >= 0) || !(thrust_fraction > 0)) {
+            throw invalid_argument("mass must not be negative and thrust fraction must be positive");
+        }
+        if (!(mass_step >= 0)) {
+            throw invalid_argument("mass step must not be negative");
+        }
+        if (refine < 0 || refine == 1) {
+            throw invalid_argument("refinement factor must be 0 (off) or at least 2");
+        }
+        if (aircraft < 0 || aircraft >= aircraft_registry().size()) {
+            throw invalid_argument("unknown aircraft id " + to_string(aircraft));
+        }
+        if (jump < 1) {
+            throw invalid_argument("jump must be at least 1");
+        }
+        if ((refine > 1) + (mass_step > 0) + best_first + (jump > 1) > 1) {
+            throw invalid_argument("mass state, corridor refinement, best-first search and "
+                                   "jump stencils can't be combined");
+        }
+        if (optimal_controls && (refine > 1 || mass_step > 0 || best_first || jump > 1)) {
+            throw invalid_argument("optimal controls need the plain grid sweep");
+        }
+    }
+};
+
+// Calls f with the scenario's aircraft: the policy type of a built-in type,
+// so its calls inline, or the registry's parameter block for the others.
+// Every aircraft-dependent path dispatches through here.
+template <class F>
+auto with_aircraft(const Scenario& scenario, F f) -> decltype(f(Tu134())) {
+    switch (scenario.aircraft) {
+        case AIRCRAFT_TU134: return f(Tu134());
+        case AIRCRAFT_TU154: return f(Tu154());
+        case AIRCRAFT_YAK42: return f(Yak42());
+        default: return f(aircraft_registry().model(scenario.aircraft));
+    }
+}
+
 // ========== ATMOSPHERIC MODEL ==========
 struct AtmosPoint {
     double H, rho, a;
@@ -71,61 +392,99 @@ static const AtmosPoint ATMOS_TABLE[] = {
 
 const int ATMOS_N = 12;
 
-void atmosphere(double H, double& rho, double& a_sound) {
-    if (H <= ATMOS_TABLE[0].H) {
-        rho = ATMOS_TABLE[0].rho;
-        a_sound = ATMOS_TABLE[0].a;
-        return;
-    }
-    if (H >= ATMOS_TABLE[ATMOS_N - 1].H) {
-        rho = ATMOS_TABLE[ATMOS_N - 1].rho;
-        a_sound = ATMOS_TABLE[ATMOS_N - 1].a;
-        return;
+// ATMOS_TABLE resampled on a uniform altitude step, so a lookup is one index
+// computation instead of a scan. Every breakpoint of ATMOS_TABLE is a multiple
+// of ATMOS_STEP, so the piecewise-linear profile itself does not change.
+const double ATMOS_STEP = 500.0; // m
+const int ATMOS_UNIFORM_N = 21;  // 0 .. 10000 m
+
+struct UniformAtmosphere {
+    // One padding entry with zero slope, so the top of the table needs no special case
+    double rho[ATMOS_UNIFORM_N + 1];
+    double a[ATMOS_UNIFORM_N + 1];
+    double d_rho[ATMOS_UNIFORM_N + 1];
+    double d_a[ATMOS_UNIFORM_N + 1];
+};
+
+UniformAtmosphere build_uniform_atmosphere() {
+    UniformAtmosphere table;
+
+    int seg = 0;
+    for (int k = 0; k < ATMOS_UNIFORM_N; k++) {
+        double H = ATMOS_TABLE[0].H + k * ATMOS_STEP;
+        while (seg < ATMOS_N - 2 && H > ATMOS_TABLE[seg + 1].H) seg++;
+
+        const AtmosPoint& p1 = ATMOS_TABLE[seg];
+        const AtmosPoint& p2 = ATMOS_TABLE[seg + 1];
+        double t = (H - p1.H) / (p2.H - p1.H);
+        table.rho[k] = p1.rho + t * (p2.rho - p1.rho);
+        table.a[k] = p1.a + t * (p2.a - p1.a);
     }
+    table.rho[ATMOS_UNIFORM_N] = table.rho[ATMOS_UNIFORM_N - 1];
+    table.a[ATMOS_UNIFORM_N] = table.a[ATMOS_UNIFORM_N - 1];
 
-    for (int i = 0; i < ATMOS_N - 1; i++) {
-        if (H >= ATMOS_TABLE[i].H && H < ATMOS_TABLE[i + 1].H) {
-            double t = (H - ATMOS_TABLE[i].H) / (ATMOS_TABLE[i + 1].H - ATMOS_TABLE[i].H);
-            rho = ATMOS_TABLE[i].rho + t * (ATMOS_TABLE[i + 1].rho - ATMOS_TABLE[i].rho);
-            a_sound = ATMOS_TABLE[i].a + t * (ATMOS_TABLE[i + 1].a - ATMOS_TABLE[i].a);
-            return;
-        }
+    for (int k = 0; k <= ATMOS_UNIFORM_N; k++) {
+        bool last = (k == ATMOS_UNIFORM_N);
+        table.d_rho[k] = last ? 0.0 : table.rho[k + 1] - table.rho[k];
+        table.d_a[k] = last ? 0.0 : table.a[k + 1] - table.a[k];
     }
+    return table;
+}
+
+static const UniformAtmosphere ATMOS_UNIFORM = build_uniform_atmosphere();
+
+// Branch-free, so loops over altitudes vectorize. Altitudes outside the table
+// are clamped to its ends.
+inline void atmosphere(double H, double& rho, double& a_sound) {
+    double x = (H - ATMOS_TABLE[0].H) * (1.0 / ATMOS_STEP);
+    x = min(max(x, 0.0), (double)(ATMOS_UNIFORM_N - 1));
+
+    int k = (int)x;
+    double t = x - k;
+    rho = ATMOS_UNIFORM.rho[k] + t * ATMOS_UNIFORM.d_rho[k];
+    a_sound = ATMOS_UNIFORM.a[k] + t * ATMOS_UNIFORM.d_a[k];
 }
 
 // ========== AERODYNAMIC FUNCTIONS ==========
-double getLiftCoefficient(double alpha) {
-    return min(Cl_alpha * alpha, Cy_max);
+template <class Aircraft>
+double getLiftCoefficient(const Aircraft& aircraft, double alpha) {
+    double Cl = aircraft.Cl_alpha * alpha;
+    double Cy_max = aircraft.Cy_max;
+    return min(Cl, Cy_max);
 }
 
-double getDragCoefficient(double alpha) {
-    double Cl = getLiftCoefficient(alpha);
-    return Cx0 + K * Cl * Cl;
+template <class Aircraft>
+double getDragCoefficient(const Aircraft& aircraft, double alpha) {
+    double Cl = getLiftCoefficient(aircraft, alpha);
+    return aircraft.Cx0 + aircraft.K * Cl * Cl;
 }
 
-double computeLiftForce(double V, double h, double alpha, double mass) {
+template <class Aircraft>
+double computeLiftForce(const Aircraft& aircraft, double V, double h, double alpha, double mass) {
     double rho, a_sound;
     atmosphere(h, rho, a_sound);
     double q = 0.5 * rho * V * V;
-    double Cl = getLiftCoefficient(alpha);
-    double lift = Cl * TU134_WING_AREA * q;
+    double Cl = getLiftCoefficient(aircraft, alpha);
+    double lift = Cl * aircraft.wing_area * q;
 
     // For climb calculations, we need enough lift to support the aircraft
     double required_lift = mass * GRAVITY * cos(min(alpha, MAX_CLIMB_ANGLE));
     return max(lift, required_lift * 0.8); // Safety factor
 }
 
-double computeDragForce(double V, double h, double alpha) {
+template <class Aircraft>
+double computeDragForce(const Aircraft& aircraft, double V, double h, double alpha) {
     double rho, a_sound;
     atmosphere(h, rho, a_sound);
     double q = 0.5 * rho * V * V;
-    double Cd = getDragCoefficient(alpha);
-    return Cd * TU134_WING_AREA * q;
+    double Cd = getDragCoefficient(aircraft, alpha);
+    return Cd * aircraft.wing_area * q;
 }
 
 // ========== THRUST AND FUEL FUNCTIONS ==========
-double getThrustSetting(OptimizationCriterion criterion, double alt_progress = 0.0) {
-    if (criterion == MIN_TIME) {
+template <OptimizationCriterion C>
+double getThrustSetting(double alt_progress = 0.0) {
+    if (C == MIN_TIME) {
         return 1.0; // 100% thrust for minimum time
     } else {
         // Для экономии топлива: начинаем с 85%, уменьшаем до ~72% на высоте
@@ -133,23 +492,20 @@ double getThrustSetting(OptimizationCriterion criterion, double alt_progress = 0
     }
 }
 
-double getAlphaForCriterion(OptimizationCriterion criterion, double alt_progress = 0.5,
-                           ManeuverType maneuver = COMBINED) {
+double getThrustSetting(OptimizationCriterion criterion, double alt_progress = 0.0) {
+    return criterion == MIN_TIME ? getThrustSetting<MIN_TIME>(alt_progress)
+                                 : getThrustSetting<MIN_FUEL>(alt_progress);
+}
+
+template <OptimizationCriterion C, ManeuverType M>
+double getAlphaForCriterion(double alt_progress = 0.5) {
     double base_angle;
 
-    if (criterion == MIN_TIME) {
-        switch (maneuver) {
-            case ACCELERATION: base_angle = 2.0; break;
-            case CLIMB: base_angle = 7.0; break;
-            case COMBINED: base_angle = 4.5; break;
-        }
+    if (C == MIN_TIME) {
+        base_angle = (M == ACCELERATION) ? 2.0 : (M == CLIMB) ? 7.0 : 4.5;
         base_angle *= (1.0 - alt_progress * 0.2);
     } else {
-        switch (maneuver) {
-            case ACCELERATION: base_angle = 1.5; break;
-            case CLIMB: base_angle = 5.0; break;
-            case COMBINED: base_angle = 3.0; break;
-        }
+        base_angle = (M == ACCELERATION) ? 1.5 : (M == CLIMB) ? 5.0 : 3.0;
         base_angle *= (1.0 - alt_progress * 0.1);
     }
 
@@ -157,10 +513,156 @@ double getAlphaForCriterion(OptimizationCriterion criterion, double alt_progress
     return base_angle * M_PI / 180.0;
 }
 
-double computeFuelFlow(double thrust) {
-    return thrust * Cp / 3600.0;
+template <OptimizationCriterion C>
+double getAlphaForCriterion(double alt_progress, ManeuverType maneuver) {
+    switch (maneuver) {
+        case ACCELERATION: return getAlphaForCriterion<C, ACCELERATION>(alt_progress);
+        case CLIMB: return getAlphaForCriterion<C, CLIMB>(alt_progress);
+        default: return getAlphaForCriterion<C, COMBINED>(alt_progress);
+    }
+}
+
+double getAlphaForCriterion(OptimizationCriterion criterion, double alt_progress = 0.5,
+                           ManeuverType maneuver = COMBINED) {
+    return criterion == MIN_TIME ? getAlphaForCriterion<MIN_TIME>(alt_progress, maneuver)
+                                 : getAlphaForCriterion<MIN_FUEL>(alt_progress, maneuver);
+}
+
+template <class Aircraft>
+double computeFuelFlow(const Aircraft& aircraft, double thrust) {
+    return thrust * aircraft.Cp / 3600.0;
+}
+
+// ========== PROFILING COUNTERS ==========
+// Why a segment kernel rejected an edge: the first condition that failed
+enum RejectReason {
+    REJECT_NONE = 0,      // valid
+    REJECT_GEOMETRY,      // H2 <= H1, V2 <= V1 or a step longer than allowed
+    REJECT_SPEED,         // below the minimum climb speed
+    REJECT_DV_DT,         // longitudinal acceleration too low
+    REJECT_EXCESS_POWER,  // vertical excess power too low
+    REJECT_DT_CAP,        // segment time out of range
+    REJECT_MASS_FLOOR,    // would burn below the mass floor
+    REJECT_REASONS
+};
+
+// Edges offered to accept_edge by this thread, counted in every build: --bench
+// divides its times by the edges a solve really evaluated, which the search
+// modes change. Wavefront workers move theirs to worker_edges_evaluated.
+thread_local long long edges_evaluated_here = 0;
+atomic<long long> worker_edges_evaluated(0);
+
+// Edges evaluated by the calling thread and the workers it ran since the last call
+long long take_edges_evaluated() {
+    long long count = edges_evaluated_here + worker_edges_evaluated.exchange(0);
+    edges_evaluated_here = 0;
+    return count;
+}
+
+// Built with -DHW_PROFILE, the solvers count evaluated edges, rejections by
+// reason, relaxations and the time spent in each segment kernel. Counters are
+// per thread and summed by profile_take(); without HW_PROFILE the macros
+// expand to nothing and the counters don't exist.
+#ifdef HW_PROFILE
+const char* const REJECT_REASON_NAMES[REJECT_REASONS] = {
+    "none", "geometry", "speed", "dV_dt", "excess_power", "dt_cap", "mass_floor"};
+
+struct SolverCounters {
+    long long edges_evaluated;
+    long long rejected[REJECT_REASONS];
+    long long relaxations;  // valid edges offered to a cell
+    long long improvements; // relaxations that lowered the cell's cost
+    long long kernel_calls[3];
+    long long kernel_lanes[3]; // edges computed: 1 per scalar call, the filled lanes per batch call
+    double kernel_ns[3];    // by maneuver: acceleration, climb, combined
+
+    SolverCounters() { memset(this, 0, sizeof(*this)); }
+
+    void add(const SolverCounters& other) {
+        edges_evaluated += other.edges_evaluated;
+        for (int r = 0; r < REJECT_REASONS; r++) rejected[r] += other.rejected[r];
+        relaxations += other.relaxations;
+        improvements += other.improvements;
+        for (int m = 0; m < 3; m++) {
+            kernel_calls[m] += other.kernel_calls[m];
+            kernel_lanes[m] += other.kernel_lanes[m];
+            kernel_ns[m] += other.kernel_ns[m];
+        }
+    }
+};
+
+thread_local SolverCounters profile_counters;
+SolverCounters profile_total;
+mutex profile_mutex;
+
+// Moves the calling thread's counters into the total
+void profile_flush() {
+    lock_guard<mutex> lock(profile_mutex);
+    profile_total.add(profile_counters);
+    profile_counters = SolverCounters();
+}
+
+// Counters of every thread since the last call; worker threads flush before they exit
+SolverCounters profile_take() {
+    profile_flush();
+    lock_guard<mutex> lock(profile_mutex);
+    SolverCounters taken = profile_total;
+    profile_total = SolverCounters();
+    return taken;
+}
+
+inline void profile_edge(bool valid, int reason) {
+    profile_counters.edges_evaluated++;
+    if (!valid) profile_counters.rejected[reason]++;
+}
+
+// Adds its lifetime to the kernel time of one maneuver
+class KernelTimer {
+private:
+    int slot;
+    int lanes;
+    chrono::steady_clock::time_point start;
+
+public:
+    KernelTimer(ManeuverType maneuver, int lanes)
+        : slot(maneuver - 1), lanes(lanes), start(chrono::steady_clock::now()) {}
+    ~KernelTimer() {
+        profile_counters.kernel_calls[slot]++;
+        profile_counters.kernel_lanes[slot] += lanes;
+        profile_counters.kernel_ns[slot] +=
+            chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    }
+};
+
+void print_profile_counters(const SolverCounters& counters, ostream& out) {
+    out << "\nSOLVER COUNTERS:\n";
+    out << " Edges evaluated: " << counters.edges_evaluated << "\n";
+    for (int r = REJECT_GEOMETRY; r < REJECT_REASONS; r++) {
+        out << "  rejected, " << left << setw(13) << REJECT_REASON_NAMES[r] << right << ": "
+            << counters.rejected[r] << "\n";
+    }
+    out << " Relaxations: " << counters.relaxations << " (" << counters.improvements << " improved a cell)\n";
+    const char* const kernels[3] = {"acceleration", "climb", "combined"};
+    for (int m = 0; m < 3; m++) {
+        out << " Kernel " << left << setw(13) << kernels[m] << right << ": " << counters.kernel_calls[m]
+            << " calls, " << counters.kernel_lanes[m] << " edges, " << fixed << setprecision(3) << counters.kernel_ns[m] * 1e-6 << " ms\n";
+        out.unsetf(ios::fixed);
+    }
 }
 
+#define PROFILE_COUNT(field) (profile_counters.field++)
+#define PROFILE_EDGE(valid, reason) profile_edge(valid, reason)
+#define PROFILE_KERNEL(maneuver) KernelTimer kernel_timer(maneuver, 1)
+#define PROFILE_KERNEL_BATCH(maneuver, lanes) KernelTimer kernel_timer(maneuver, lanes)
+#define PROFILE_FLUSH() profile_flush()
+#else
+#define PROFILE_COUNT(field) ((void)0)
+#define PROFILE_EDGE(valid, reason) ((void)(reason))
+#define PROFILE_KERNEL(maneuver) ((void)0)
+#define PROFILE_KERNEL_BATCH(maneuver, lanes) ((void)0)
+#define PROFILE_FLUSH() ((void)0)
+#endif
+
 // ========== SEGMENT CALCULATIONS ==========
 struct SegmentData {
     double time;
@@ -169,34 +671,141 @@ struct SegmentData {
     double Vy;
     double theta;
     bool valid;
+    RejectReason reason; // why the segment is invalid
 
-    SegmentData() : time(1e9), fuel(1e9), dV_dt(0), Vy(0), theta(0), valid(false) {}
+    SegmentData() : time(1e9), fuel(1e9), dV_dt(0), Vy(0), theta(0), valid(false),
+                    reason(REJECT_NONE) {}
 };
 
-SegmentData calculate_acceleration(double H, double V1, double V2, double mass,
-                                  OptimizationCriterion criterion) {
+inline SegmentData rejected_segment(RejectReason reason) {
     SegmentData result;
+    result.reason = reason;
+    return result;
+}
 
-    if (V2 <= V1) return result;
+// Part of the segment physics that depends only on the altitude, the
+// criterion and the maneuver: atmosphere, control angles, thrust and the
+// aerodynamic coefficients. What is left per segment is a few multiplies.
+struct SegmentRow {
+    double half_rho;       // 0.5 * rho
+    double thrust;
+    double thrust_x;       // thrust * cos(alpha + phi_p)
+    double thrust_y;       // thrust * sin(alpha + phi_p)
+    double lift_area;      // Cl * S
+    double drag_area;      // Cd * S
+    double cos_alpha_lift; // cos(min(alpha, MAX_CLIMB_ANGLE)) for the lift floor
+    double fuel_flow;
+};
 
-    double V_avg = 0.5 * (V1 + V2);
-    double alt_progress = (H - INITIAL_ALTITUDE) / (FINAL_ALTITUDE - INITIAL_ALTITUDE);
+// Angle of attack and thrust setting of the fixed control schedule at altitude H
+template <OptimizationCriterion C, ManeuverType M>
+void schedule_controls(double H, const Scenario& scenario, double& alpha, double& thrust_setting) {
+    double alt_progress = (H - scenario.initial_altitude)
+                        / (scenario.final_altitude - scenario.initial_altitude);
+    alpha = getAlphaForCriterion<C, M>(alt_progress);
+    thrust_setting = getThrustSetting<C>(alt_progress);
+    if (M == COMBINED && C == MIN_FUEL) {
+        thrust_setting = min(thrust_setting * 1.1, 0.9);
+    }
+}
+
+// Fills the control terms of a row: everything but half_rho
+template <class Aircraft>
+void set_segment_controls(SegmentRow& row, const Aircraft& aircraft, double alpha,
+                          double thrust_setting, double thrust_fraction) {
+    double phi_p = aircraft.engine_angle * M_PI / 180.0;
+
+    row.thrust = aircraft.nominal_thrust * thrust_fraction * thrust_setting;
+    row.thrust_x = row.thrust * cos(alpha + phi_p);
+    row.thrust_y = row.thrust * sin(alpha + phi_p);
+    row.lift_area = getLiftCoefficient(aircraft, alpha) * aircraft.wing_area;
+    row.drag_area = getDragCoefficient(aircraft, alpha) * aircraft.wing_area;
+    row.cos_alpha_lift = cos(min(alpha, MAX_CLIMB_ANGLE));
+    row.fuel_flow = computeFuelFlow(aircraft, row.thrust);
+}
+
+template <OptimizationCriterion C, ManeuverType M, class Aircraft>
+SegmentRow prepare_segment_row(const Aircraft& aircraft, double H, const Scenario& scenario) {
+    SegmentRow row;
+
+    double rho, a_sound;
+    atmosphere(H, rho, a_sound);
+
+    double alpha, thrust_setting;
+    schedule_controls<C, M>(H, scenario, alpha, thrust_setting);
+
+    row.half_rho = 0.5 * rho;
+    set_segment_controls(row, aircraft, alpha, thrust_setting, scenario.thrust_fraction);
+    return row;
+}
+
+template <OptimizationCriterion C, class Aircraft>
+SegmentRow prepare_segment_row(const Aircraft& aircraft, double H, ManeuverType maneuver,
+                               const Scenario& scenario) {
+    switch (maneuver) {
+        case ACCELERATION: return prepare_segment_row<C, ACCELERATION>(aircraft, H, scenario);
+        case CLIMB: return prepare_segment_row<C, CLIMB>(aircraft, H, scenario);
+        default: return prepare_segment_row<C, COMBINED>(aircraft, H, scenario);
+    }
+}
 
-    double alpha = getAlphaForCriterion(criterion, alt_progress, ACCELERATION);
-    double thrust_setting = getThrustSetting(criterion, alt_progress);
-    double thrust = TU134_NOMINAL_THRUST * MAX_THRUST_PERCENT * thrust_setting;
+template <class Aircraft>
+SegmentRow prepare_segment_row(const Aircraft& aircraft, double H, OptimizationCriterion criterion,
+                               ManeuverType maneuver, const Scenario& scenario) {
+    return criterion == MIN_TIME ? prepare_segment_row<MIN_TIME>(aircraft, H, maneuver, scenario)
+                                 : prepare_segment_row<MIN_FUEL>(aircraft, H, maneuver, scenario);
+}
+
+// Row for the scenario's aircraft. Built-in types use their policy, the
+// others the registry's parameter block.
+SegmentRow prepare_segment_row(double H, OptimizationCriterion criterion, ManeuverType maneuver,
+                               const Scenario& scenario) {
+    return with_aircraft(scenario, [&](const auto& aircraft) {
+        return prepare_segment_row(aircraft, H, criterion, maneuver, scenario);
+    });
+}
+
+// Same as computeLiftForce, with the altitude terms taken from the row
+inline double rowLiftForce(const SegmentRow& row, double V, double mass) {
+    double q = row.half_rho * V * V;
+    double lift = row.lift_area * q;
+    double required_lift = mass * GRAVITY * row.cos_alpha_lift;
+    return max(lift, required_lift * 0.8); // Safety factor
+}
+
+// True when rowLiftForce at speed V comes from the 0.8 m g floor rather than
+// from the wing, i.e. the row's angle of attack doesn't actually hold the aircraft
+inline bool rowLiftFloorActive(const SegmentRow& row, double V, double mass) {
+    return row.lift_area * row.half_rho * V * V < mass * GRAVITY * row.cos_alpha_lift * 0.8;
+}
 
-    double drag = computeDragForce(V_avg, H, alpha);
-    double min_dV_dt = (criterion == MIN_TIME) ? 0.01 : 0.005;
+// Same as computeDragForce, with the altitude terms taken from the row
+inline double rowDragForce(const SegmentRow& row, double V) {
+    double q = row.half_rho * V * V;
+    return row.drag_area * q;
+}
+
+// row: prepared at H for ACCELERATION
+template <OptimizationCriterion C>
+SegmentData calculate_acceleration(const SegmentRow& row, double V1, double V2, double mass) {
+    PROFILE_KERNEL(ACCELERATION);
+    const bool min_time = (C == MIN_TIME);
+    SegmentData result;
+
+    if (V2 <= V1) return rejected_segment(REJECT_GEOMETRY);
 
-    double dV_dt = (thrust * cos(alpha + phi_p) - drag) / mass;
-    if (dV_dt <= min_dV_dt) return result;
+    double V_avg = 0.5 * (V1 + V2);
+
+    double drag = rowDragForce(row, V_avg);
+    double min_dV_dt = min_time ? 0.01 : 0.005;
+
+    double dV_dt = (row.thrust_x - drag) / mass;
+    if (dV_dt <= min_dV_dt) return rejected_segment(REJECT_DV_DT);
 
     double dt = (V2 - V1) / dV_dt;
-    if (dt <= 0 || dt > 1000.0) return result;
+    if (dt <= 0 || dt > 1000.0) return rejected_segment(REJECT_DT_CAP);
 
-    double fuel_flow = computeFuelFlow(thrust);
-    double fuel = fuel_flow * dt;
+    double fuel = row.fuel_flow * dt;
 
     result.time = dt;
     result.fuel = fuel;
@@ -208,48 +817,55 @@ SegmentData calculate_acceleration(double H, double V1, double V2, double mass,
     return result;
 }
 
-SegmentData calculate_climb(double H1, double H2, double V, double mass,
-                           OptimizationCriterion criterion) {
-    SegmentData result;
+SegmentData calculate_acceleration(const SegmentRow& row, double V1, double V2, double mass,
+                                  OptimizationCriterion criterion) {
+    return criterion == MIN_TIME ? calculate_acceleration<MIN_TIME>(row, V1, V2, mass)
+                                 : calculate_acceleration<MIN_FUEL>(row, V1, V2, mass);
+}
 
-    if (H2 <= H1) return result;
+SegmentData calculate_acceleration(double H, double V1, double V2, double mass,
+                                  OptimizationCriterion criterion, const Scenario& scenario) {
+    if (V2 <= V1) return SegmentData();
+    return calculate_acceleration(prepare_segment_row(H, criterion, ACCELERATION, scenario),
+                                  V1, V2, mass, criterion);
+}
 
-    double min_climb_speed = (criterion == MIN_TIME) ? MIN_CLIMB_SPEED : MIN_CLIMB_SPEED * 1.1;
-    if (V < min_climb_speed) return result;
+// row: prepared at 0.5 * (H1 + H2) for CLIMB
+template <OptimizationCriterion C>
+SegmentData calculate_climb(const SegmentRow& row, double H1, double H2, double V, double mass) {
+    PROFILE_KERNEL(CLIMB);
+    const bool min_time = (C == MIN_TIME);
+    SegmentData result;
 
-    double H_avg = 0.5 * (H1 + H2);
-    double alt_progress = (H_avg - INITIAL_ALTITUDE) / (FINAL_ALTITUDE - INITIAL_ALTITUDE);
+    if (H2 <= H1) return rejected_segment(REJECT_GEOMETRY);
 
-    double alpha = getAlphaForCriterion(criterion, alt_progress, CLIMB);
-    double thrust_setting = getThrustSetting(criterion, alt_progress);
-    double thrust = TU134_NOMINAL_THRUST * MAX_THRUST_PERCENT * thrust_setting;
+    double min_climb_speed = min_time ? MIN_CLIMB_SPEED : MIN_CLIMB_SPEED * 1.1;
+    if (V < min_climb_speed) return rejected_segment(REJECT_SPEED);
 
-    double lift = computeLiftForce(V, H_avg, alpha, mass);
-    double drag = computeDragForce(V, H_avg, alpha);
+    double lift = rowLiftForce(row, V, mass);
 
-    double thrust_vertical = thrust * sin(alpha + phi_p);
+    double thrust_vertical = row.thrust_y;
     double required_lift = mass * GRAVITY;
     double excess_power_vertical = thrust_vertical + (lift - required_lift);
 
-    double min_excess = (criterion == MIN_TIME) ? mass * GRAVITY * 0.01 : mass * GRAVITY * 0.005;
-    if (excess_power_vertical <= min_excess) return result;
+    double min_excess = min_time ? mass * GRAVITY * 0.01 : mass * GRAVITY * 0.005;
+    if (excess_power_vertical <= min_excess) return rejected_segment(REJECT_EXCESS_POWER);
 
     double sin_theta = min(excess_power_vertical / (mass * GRAVITY), sin(MAX_CLIMB_ANGLE));
-    double min_sin_theta = (criterion == MIN_TIME) ? 0.02 : 0.015;
+    double min_sin_theta = min_time ? 0.02 : 0.015;
     sin_theta = max(sin_theta, min_sin_theta);
 
     double Vy = V * sin_theta;
-    double max_vy = (criterion == MIN_TIME) ? MAX_VERTICAL_SPEED : MAX_VERTICAL_SPEED * 0.9;
+    double max_vy = min_time ? MAX_VERTICAL_SPEED : MAX_VERTICAL_SPEED * 0.9;
     if (Vy > max_vy) {
         Vy = max_vy;
         sin_theta = Vy / V;
     }
 
     double dt = (H2 - H1) / Vy;
-    if (dt <= 0 || dt > 2000.0) return result;
+    if (dt <= 0 || dt > 2000.0) return rejected_segment(REJECT_DT_CAP);
 
-    double fuel_flow = computeFuelFlow(thrust);
-    double fuel = fuel_flow * dt;
+    double fuel = row.fuel_flow * dt;
 
     result.time = dt;
     result.fuel = fuel;
@@ -261,61 +877,71 @@ SegmentData calculate_climb(double H1, double H2, double V, double mass,
     return result;
 }
 
-SegmentData calculate_combined(double H1, double H2, double V1, double V2, double mass,
-                              OptimizationCriterion criterion) {
+SegmentData calculate_climb(const SegmentRow& row, double H1, double H2, double V, double mass,
+                           OptimizationCriterion criterion) {
+    return criterion == MIN_TIME ? calculate_climb<MIN_TIME>(row, H1, H2, V, mass)
+                                 : calculate_climb<MIN_FUEL>(row, H1, H2, V, mass);
+}
+
+SegmentData calculate_climb(double H1, double H2, double V, double mass,
+                           OptimizationCriterion criterion, const Scenario& scenario) {
+    if (H2 <= H1) return SegmentData();
+    return calculate_climb(prepare_segment_row(0.5 * (H1 + H2), criterion, CLIMB, scenario),
+                           H1, H2, V, mass, criterion);
+}
+
+// row: prepared at 0.5 * (H1 + H2) for COMBINED
+template <OptimizationCriterion C>
+SegmentData calculate_combined(const SegmentRow& row, double H1, double H2, double V1, double V2,
+                              double mass, const Scenario& scenario) {
+    PROFILE_KERNEL(COMBINED);
+    const bool min_time = (C == MIN_TIME);
     SegmentData result;
 
-    if (H2 <= H1 || V2 <= V1) return result;
+    if (H2 <= H1 || V2 <= V1) return rejected_segment(REJECT_GEOMETRY);
 
-    if (criterion == MIN_FUEL) {
+    if (!min_time) {
         double dH = H2 - H1;
         double dV = V2 - V1;
-        double max_dH_step = (FINAL_ALTITUDE - INITIAL_ALTITUDE) / N;
-        double max_dV_step = (FINAL_VELOCITY - INITIAL_VELOCITY) / N;
+        double max_dH_step = scenario.stepH();
+        double max_dV_step = scenario.stepV();
 
-        if (dH > max_dH_step * 1.5 || dV > max_dV_step * 1.5) {
-            return result;
+        // Half a step of slack beyond the longest jump of the stencil
+        double max_steps = scenario.jump + 0.5;
+        if (dH > max_dH_step * max_steps || dV > max_dV_step * max_steps) {
+            return rejected_segment(REJECT_GEOMETRY);
         }
     }
 
-    double H_avg = 0.5 * (H1 + H2);
     double V_avg = 0.5 * (V1 + V2);
-    double alt_progress = (H_avg - INITIAL_ALTITUDE) / (FINAL_ALTITUDE - INITIAL_ALTITUDE);
-
-    double alpha = getAlphaForCriterion(criterion, alt_progress, COMBINED);
-    double base_thrust_setting = getThrustSetting(criterion, alt_progress);
-    double thrust_setting = (criterion == MIN_TIME) ? base_thrust_setting :
-                           min(base_thrust_setting * 1.1, 0.9);
-
-    double thrust = TU134_NOMINAL_THRUST * MAX_THRUST_PERCENT * thrust_setting;
 
-    double lift = computeLiftForce(V_avg, H_avg, alpha, mass);
-    double drag = computeDragForce(V_avg, H_avg, alpha);
+    double lift = rowLiftForce(row, V_avg, mass);
+    double drag = rowDragForce(row, V_avg);
 
-    double min_dV_dt = (criterion == MIN_TIME) ? 0.01 : 0.003;
+    double min_dV_dt = min_time ? 0.01 : 0.003;
 
-    double dV_dt = (thrust * cos(alpha + phi_p) - drag) / mass;
+    double dV_dt = (row.thrust_x - drag) / mass;
     if (dV_dt <= min_dV_dt) {
-        if (criterion == MIN_FUEL && dV_dt > 0) {
+        if (!min_time && dV_dt > 0) {
             dV_dt = max(dV_dt, min_dV_dt);
         } else {
-            return result;
+            return rejected_segment(REJECT_DV_DT);
         }
     }
 
-    double thrust_vertical = thrust * sin(alpha + phi_p);
+    double thrust_vertical = row.thrust_y;
     double required_lift = mass * GRAVITY;
     double excess_power_vertical = thrust_vertical + (lift - required_lift);
 
-    double min_excess = (criterion == MIN_TIME) ? mass * GRAVITY * 0.005 : mass * GRAVITY * 0.002;
-    if (excess_power_vertical <= min_excess) return result;
+    double min_excess = min_time ? mass * GRAVITY * 0.005 : mass * GRAVITY * 0.002;
+    if (excess_power_vertical <= min_excess) return rejected_segment(REJECT_EXCESS_POWER);
 
     double sin_theta = min(excess_power_vertical / (mass * GRAVITY), sin(MAX_CLIMB_ANGLE * 0.6));
-    double min_sin_theta = (criterion == MIN_TIME) ? 0.015 : 0.01;
+    double min_sin_theta = min_time ? 0.015 : 0.01;
     sin_theta = max(sin_theta, min_sin_theta);
 
     double Vy = V_avg * sin_theta;
-    double max_vy_limit = (criterion == MIN_TIME) ? MAX_VERTICAL_SPEED * 1.2 : MAX_VERTICAL_SPEED;
+    double max_vy_limit = min_time ? MAX_VERTICAL_SPEED * 1.2 : MAX_VERTICAL_SPEED;
     if (Vy > max_vy_limit) Vy = max_vy_limit;
 
     double dH = H2 - H1;
@@ -325,14 +951,13 @@ SegmentData calculate_combined(double H1, double H2, double V1, double V2, doubl
     double time_for_accel = dV / dV_dt;
     double dt = max(time_for_climb, time_for_accel);
 
-    double max_dt = (criterion == MIN_TIME) ? 1500.0 : 2000.0;
-    if (dt <= 0 || dt > max_dt) return result;
+    double max_dt = min_time ? 1500.0 : 2000.0;
+    if (dt <= 0 || dt > max_dt) return rejected_segment(REJECT_DT_CAP);
 
     Vy = dH / dt;
     dV_dt = dV / dt;
 
-    double fuel_flow = computeFuelFlow(thrust);
-    double fuel = fuel_flow * dt;
+    double fuel = row.fuel_flow * dt;
 
     result.time = dt;
     result.fuel = fuel;
@@ -344,6 +969,270 @@ SegmentData calculate_combined(double H1, double H2, double V1, double V2, doubl
     return result;
 }
 
+SegmentData calculate_combined(const SegmentRow& row, double H1, double H2, double V1, double V2,
+                              double mass, OptimizationCriterion criterion,
+                              const Scenario& scenario) {
+    return criterion == MIN_TIME ? calculate_combined<MIN_TIME>(row, H1, H2, V1, V2, mass, scenario)
+                                 : calculate_combined<MIN_FUEL>(row, H1, H2, V1, V2, mass, scenario);
+}
+
+SegmentData calculate_combined(double H1, double H2, double V1, double V2, double mass,
+                              OptimizationCriterion criterion, const Scenario& scenario) {
+    if (H2 <= H1 || V2 <= V1) return SegmentData();
+    return calculate_combined(prepare_segment_row(0.5 * (H1 + H2), criterion, COMBINED, scenario),
+                              H1, H2, V1, V2, mass, criterion, scenario);
+}
+
+// ========== BATCHED SEGMENT KERNELS ==========
+// Struct-of-arrays block of segments. Row terms are stored per lane, so one
+// block can hold part of a grid row (one altitude) or of a diagonal (one
+// altitude per lane). The kernels below are branch-free loops over all lanes
+// of the block that the compiler vectorizes for the target instruction set
+// (AVX2/AVX-512); keeping the arrays inside one struct and the trip count
+// fixed is what lets it prove the lanes independent. Lanes past count hold
+// stale inputs and their outputs are ignored. Only time, fuel and validity
+// are computed, which is all the DP needs; the scalar kernels stay the
+// reference and also return dV_dt, Vy and theta.
+const int SEGMENT_BATCH_SIZE = 64;
+
+struct SegmentBatch {
+    int count;
+
+    // Inputs
+    double H1[SEGMENT_BATCH_SIZE];
+    double H2[SEGMENT_BATCH_SIZE];
+    double V1[SEGMENT_BATCH_SIZE];
+    double V2[SEGMENT_BATCH_SIZE];
+    double mass[SEGMENT_BATCH_SIZE];
+    double half_rho[SEGMENT_BATCH_SIZE];
+    double thrust_x[SEGMENT_BATCH_SIZE];
+    double thrust_y[SEGMENT_BATCH_SIZE];
+    double lift_area[SEGMENT_BATCH_SIZE];
+    double drag_area[SEGMENT_BATCH_SIZE];
+    double cos_alpha_lift[SEGMENT_BATCH_SIZE];
+    double fuel_flow[SEGMENT_BATCH_SIZE];
+
+    // Outputs
+    double time[SEGMENT_BATCH_SIZE];
+    double fuel[SEGMENT_BATCH_SIZE];
+    unsigned char valid[SEGMENT_BATCH_SIZE];
+    unsigned char reason[SEGMENT_BATCH_SIZE]; // RejectReason, filled only with HW_PROFILE
+
+    SegmentBatch() {
+        memset(this, 0, sizeof(*this));
+    }
+
+    void set(int k, const SegmentRow& row, double h1, double h2, double v1, double v2, double m) {
+        H1[k] = h1;
+        H2[k] = h2;
+        V1[k] = v1;
+        V2[k] = v2;
+        mass[k] = m;
+        half_rho[k] = row.half_rho;
+        thrust_x[k] = row.thrust_x;
+        thrust_y[k] = row.thrust_y;
+        lift_area[k] = row.lift_area;
+        drag_area[k] = row.drag_area;
+        cos_alpha_lift[k] = row.cos_alpha_lift;
+        fuel_flow[k] = row.fuel_flow;
+    }
+};
+
+// Batched calculate_acceleration; lanes use V1, V2 and mass
+template <OptimizationCriterion C>
+void calculate_acceleration_batch(SegmentBatch& b) {
+    PROFILE_KERNEL_BATCH(ACCELERATION, b.count);
+    const double min_dV_dt = (C == MIN_TIME) ? 0.01 : 0.005;
+
+    for (int k = 0; k < SEGMENT_BATCH_SIZE; k++) {
+        double V_avg = 0.5 * (b.V1[k] + b.V2[k]);
+        double drag = b.drag_area[k] * (b.half_rho[k] * V_avg * V_avg);
+        double dV_dt = (b.thrust_x[k] - drag) / b.mass[k];
+        double dt = (b.V2[k] - b.V1[k]) / dV_dt;
+
+        b.time[k] = dt;
+        b.fuel[k] = b.fuel_flow[k] * dt;
+        b.valid[k] = (b.V2[k] > b.V1[k]) & (dV_dt > min_dV_dt) & (dt > 0) & (dt <= 1000.0);
+#ifdef HW_PROFILE
+        b.reason[k] = !(b.V2[k] > b.V1[k]) ? REJECT_GEOMETRY : !(dV_dt > min_dV_dt) ? REJECT_DV_DT
+                    : !((dt > 0) & (dt <= 1000.0)) ? REJECT_DT_CAP : REJECT_NONE;
+#endif
+    }
+}
+
+// Batched calculate_climb; lanes use H1, H2, V1 and mass
+template <OptimizationCriterion C>
+void calculate_climb_batch(SegmentBatch& b) {
+    PROFILE_KERNEL_BATCH(CLIMB, b.count);
+    const bool min_time = (C == MIN_TIME);
+    const double min_climb_speed = min_time ? MIN_CLIMB_SPEED : MIN_CLIMB_SPEED * 1.1;
+    const double min_excess_share = min_time ? 0.01 : 0.005;
+    const double max_sin_theta = sin(MAX_CLIMB_ANGLE);
+    const double min_sin_theta = min_time ? 0.02 : 0.015;
+    const double max_vy = min_time ? MAX_VERTICAL_SPEED : MAX_VERTICAL_SPEED * 0.9;
+
+    for (int k = 0; k < SEGMENT_BATCH_SIZE; k++) {
+        double V = b.V1[k];
+        double weight = b.mass[k] * GRAVITY;
+
+        double lift = b.lift_area[k] * (b.half_rho[k] * V * V);
+        lift = max(lift, weight * b.cos_alpha_lift[k] * 0.8);
+
+        double excess_power_vertical = b.thrust_y[k] + (lift - weight);
+
+        double sin_theta = min(excess_power_vertical / weight, max_sin_theta);
+        sin_theta = max(sin_theta, min_sin_theta);
+
+        double Vy = min(V * sin_theta, max_vy);
+        double dt = (b.H2[k] - b.H1[k]) / Vy;
+
+        b.time[k] = dt;
+        b.fuel[k] = b.fuel_flow[k] * dt;
+        b.valid[k] = (b.H2[k] > b.H1[k]) & (V >= min_climb_speed) &
+                   (excess_power_vertical > weight * min_excess_share) &
+                   (dt > 0) & (dt <= 2000.0);
+#ifdef HW_PROFILE
+        b.reason[k] = !(b.H2[k] > b.H1[k]) ? REJECT_GEOMETRY : !(V >= min_climb_speed) ? REJECT_SPEED
+                    : !(excess_power_vertical > weight * min_excess_share) ? REJECT_EXCESS_POWER
+                    : !((dt > 0) & (dt <= 2000.0)) ? REJECT_DT_CAP : REJECT_NONE;
+#endif
+    }
+}
+
+// Batched calculate_combined; lanes use H1, H2, V1, V2 and mass
+template <OptimizationCriterion C>
+void calculate_combined_batch(SegmentBatch& b, const Scenario& scenario) {
+    PROFILE_KERNEL_BATCH(COMBINED, b.count);
+    const bool min_time = (C == MIN_TIME);
+    // MIN_FUEL limits the step size and floors dV_dt instead of rejecting it
+    const double max_steps = scenario.jump + 0.5;
+    const double max_dH = min_time ? numeric_limits<double>::infinity() : scenario.stepH() * max_steps;
+    const double max_dV = min_time ? numeric_limits<double>::infinity() : scenario.stepV() * max_steps;
+    const double min_dV_dt = min_time ? 0.01 : 0.003;
+    const double dV_dt_reject = min_time ? min_dV_dt : 0.0;
+    const double dV_dt_floor = min_time ? -numeric_limits<double>::infinity() : min_dV_dt;
+    const double min_excess_share = min_time ? 0.005 : 0.002;
+    const double max_sin_theta = sin(MAX_CLIMB_ANGLE * 0.6);
+    const double min_sin_theta = min_time ? 0.015 : 0.01;
+    const double max_vy = min_time ? MAX_VERTICAL_SPEED * 1.2 : MAX_VERTICAL_SPEED;
+    const double max_dt = min_time ? 1500.0 : 2000.0;
+
+    for (int k = 0; k < SEGMENT_BATCH_SIZE; k++) {
+        double dH = b.H2[k] - b.H1[k];
+        double dV = b.V2[k] - b.V1[k];
+        double V_avg = 0.5 * (b.V1[k] + b.V2[k]);
+        double weight = b.mass[k] * GRAVITY;
+
+        double q = b.half_rho[k] * V_avg * V_avg;
+        double lift = max(b.lift_area[k] * q, weight * b.cos_alpha_lift[k] * 0.8);
+        double drag = b.drag_area[k] * q;
+
+        double dV_dt = (b.thrust_x[k] - drag) / b.mass[k];
+        bool accel_ok = dV_dt > dV_dt_reject;
+        dV_dt = max(dV_dt, dV_dt_floor);
+
+        double excess_power_vertical = b.thrust_y[k] + (lift - weight);
+
+        double sin_theta = min(excess_power_vertical / weight, max_sin_theta);
+        sin_theta = max(sin_theta, min_sin_theta);
+
+        double Vy = min(V_avg * sin_theta, max_vy);
+        double dt = max(dH / Vy, dV / dV_dt);
+
+        b.time[k] = dt;
+        b.fuel[k] = b.fuel_flow[k] * dt;
+        b.valid[k] = (b.H2[k] > b.H1[k]) & (b.V2[k] > b.V1[k]) & (dH <= max_dH) & (dV <= max_dV) &
+                   accel_ok & (excess_power_vertical > weight * min_excess_share) &
+                   (dt > 0) & (dt <= max_dt);
+#ifdef HW_PROFILE
+        b.reason[k] = !((b.H2[k] > b.H1[k]) & (b.V2[k] > b.V1[k]) & (dH <= max_dH) & (dV <= max_dV))
+                        ? REJECT_GEOMETRY
+                    : !accel_ok ? REJECT_DV_DT
+                    : !(excess_power_vertical > weight * min_excess_share) ? REJECT_EXCESS_POWER
+                    : !((dt > 0) & (dt <= max_dt)) ? REJECT_DT_CAP : REJECT_NONE;
+#endif
+    }
+}
+
+// ========== SEGMENT COST CACHE ==========
+// Segment rows of one altitude axis, aircraft, thrust limit and criterion
+struct SegmentTable {
+    bool built;
+    int NH;
+    int aircraft;
+    double H_first, H_last, thrust_fraction;
+    vector<SegmentRow> accel;    // at H_grid[i]
+    vector<SegmentRow> climb;    // at the midpoint of rows i and i + 1
+    vector<SegmentRow> combined; // at the midpoint of rows i and i + 1
+    vector<SegmentRow> combined_at_rows; // at H_grid[i], for even-length jumps
+
+    SegmentTable() : built(false), NH(0), aircraft(AIRCRAFT_TU134), H_first(0), H_last(0),
+                     thrust_fraction(0) {}
+};
+
+template <OptimizationCriterion C, class Aircraft>
+void fill_segment_table(SegmentTable& table, const Aircraft& aircraft, const Scenario& scenario,
+                        const vector<double>& H_grid) {
+    int NH = (int)H_grid.size() - 1;
+
+    table.accel.resize(NH + 1);
+    table.combined_at_rows.resize(NH + 1);
+    table.climb.resize(NH);
+    table.combined.resize(NH);
+
+    for (int i = 0; i <= NH; i++) {
+        table.accel[i] = prepare_segment_row<C, ACCELERATION>(aircraft, H_grid[i], scenario);
+        table.combined_at_rows[i] = prepare_segment_row<C, COMBINED>(aircraft, H_grid[i], scenario);
+    }
+    for (int i = 0; i < NH; i++) {
+        double H_avg = 0.5 * (H_grid[i] + H_grid[i + 1]);
+        table.climb[i] = prepare_segment_row<C, CLIMB>(aircraft, H_avg, scenario);
+        table.combined[i] = prepare_segment_row<C, COMBINED>(aircraft, H_avg, scenario);
+    }
+}
+
+template <OptimizationCriterion C>
+void fill_segment_table(SegmentTable& table, const Scenario& scenario, const vector<double>& H_grid) {
+    with_aircraft(scenario, [&](const auto& aircraft) {
+        fill_segment_table<C>(table, aircraft, scenario, H_grid);
+    });
+}
+
+// Keeps the segment rows of both criteria, so repeated solves on the same
+// altitude axis (e.g. "Compare both" or a sweep over velocities and masses)
+// skip the atmosphere and trigonometry entirely.
+class SegmentCostCache {
+private:
+    SegmentTable tables[2];
+
+public:
+    const SegmentTable& lookup(OptimizationCriterion criterion, const Scenario& scenario,
+                               const vector<double>& H_grid) {
+        SegmentTable& table = tables[criterion == MIN_TIME ? 0 : 1];
+        int NH = (int)H_grid.size() - 1;
+
+        if (table.built && table.NH == NH && table.aircraft == scenario.aircraft &&
+            table.H_first == H_grid.front() && table.H_last == H_grid.back() &&
+            table.thrust_fraction == scenario.thrust_fraction) {
+            return table;
+        }
+
+        if (criterion == MIN_TIME) {
+            fill_segment_table<MIN_TIME>(table, scenario, H_grid);
+        } else {
+            fill_segment_table<MIN_FUEL>(table, scenario, H_grid);
+        }
+
+        table.built = true;
+        table.NH = NH;
+        table.aircraft = scenario.aircraft;
+        table.H_first = H_grid.front();
+        table.H_last = H_grid.back();
+        table.thrust_fraction = scenario.thrust_fraction;
+        return table;
+    }
+};
+
 // ========== TRAJECTORY RESULT STRUCTURE ==========
 struct TrajectoryResult {
     vector<pair<double, double>> path; // (altitude, velocity)
@@ -362,143 +1251,133 @@ struct TrajectoryResult {
                         used_acceleration(0), used_climb(0), used_combined(0) {}
 };
 
-// ========== GRID-BASED OPTIMIZATION ==========
-TrajectoryResult solve_trajectory_grid(OptimizationCriterion criterion) {
-    TrajectoryResult trajectory;
-
-    cout << "\n========================================\n";
-    if (criterion == MIN_TIME) {
-        cout << "OPTIMIZATION CRITERION: MINIMUM TIME\n";
-    } else {
-        cout << "OPTIMIZATION CRITERION: MINIMUM FUEL\n";
-    }
-    cout << "========================================\n\n";
-
-    double dH = (FINAL_ALTITUDE - INITIAL_ALTITUDE) / N;
-    double dV = (FINAL_VELOCITY - INITIAL_VELOCITY) / N;
+// ========== DP STATE GRID ==========
+// One packed node per (i, j) cell, stored row-major in a single buffer.
+// The accumulated cost is not kept separately: it is always equal to the
+// time (MIN_TIME) or the fuel (MIN_FUEL) field, so a node fits in 32 bytes.
+const double UNREACHED = 1e9;
 
-    vector<double> H_grid(N + 1);
-    vector<double> V_grid(N + 1);
+struct GridNode {
+    double time;
+    double fuel;
+    double mass;
+    int prev;               // flat index of the predecessor, -1 if none
+    ManeuverType maneuver;
 
-    for (int i = 0; i <= N; i++) {
-        H_grid[i] = INITIAL_ALTITUDE + i * dH;
-        V_grid[i] = INITIAL_VELOCITY + i * dV;
+    double cost(OptimizationCriterion criterion) const {
+        return (criterion == MIN_TIME) ? time : fuel;
     }
 
-    vector<vector<double>> cost(N + 1, vector<double>(N + 1, 1e9));
-    vector<vector<double>> time(N + 1, vector<double>(N + 1, 0));
-    vector<vector<double>> fuel(N + 1, vector<double>(N + 1, 0));
-    vector<vector<double>> mass(N + 1, vector<double>(N + 1, TU134_MASS));
-    vector<vector<int>> prev_i(N + 1, vector<int>(N + 1, -1));
-    vector<vector<int>> prev_j(N + 1, vector<int>(N + 1, -1));
-    vector<vector<ManeuverType>> maneuver(N + 1, vector<ManeuverType>(N + 1, ACCELERATION));
-
-    cost[0][0] = 0;
-    mass[0][0] = TU134_MASS;
-
-    for (int i = 0; i <= N; i++) {
-        for (int j = 0; j <= N; j++) {
-            if (cost[i][j] >= 1e9) continue;
-
-            double H1 = H_grid[i];
-            double V1 = V_grid[j];
-            double current_mass = mass[i][j];
-
-            // Acceleration only
-            if (j < N) {
-                double V2 = V_grid[j + 1];
-                SegmentData seg = calculate_acceleration(H1, V1, V2, current_mass, criterion);
-
-                if (seg.valid) {
-                    double new_mass = current_mass - seg.fuel;
-                    if (new_mass < TU134_MASS * 0.85) continue;
-
-                    double cost_inc = (criterion == MIN_TIME) ? seg.time : seg.fuel;
-                    double new_cost = cost[i][j] + cost_inc;
-
-                    if (new_cost < cost[i][j + 1]) {
-                        cost[i][j + 1] = new_cost;
-                        time[i][j + 1] = time[i][j] + seg.time;
-                        fuel[i][j + 1] = fuel[i][j] + seg.fuel;
-                        mass[i][j + 1] = new_mass;
-                        prev_i[i][j + 1] = i;
-                        prev_j[i][j + 1] = j;
-                        maneuver[i][j + 1] = ACCELERATION;
-                    }
-                }
-            }
-
-            // Climb only
-            if (i < N) {
-                double H2 = H_grid[i + 1];
-                SegmentData seg = calculate_climb(H1, H2, V1, current_mass, criterion);
-
-                if (seg.valid) {
-                    double new_mass = current_mass - seg.fuel;
-                    if (new_mass < TU134_MASS * 0.85) continue;
-
-                    double cost_inc = (criterion == MIN_TIME) ? seg.time : seg.fuel;
-                    double new_cost = cost[i][j] + cost_inc;
-
-                    if (new_cost < cost[i + 1][j]) {
-                        cost[i + 1][j] = new_cost;
-                        time[i + 1][j] = time[i][j] + seg.time;
-                        fuel[i + 1][j] = fuel[i][j] + seg.fuel;
-                        mass[i + 1][j] = new_mass;
-                        prev_i[i + 1][j] = i;
-                        prev_j[i + 1][j] = j;
-                        maneuver[i + 1][j] = CLIMB;
-                    }
-                }
-            }
+    template <OptimizationCriterion C>
+    double cost() const {
+        return (C == MIN_TIME) ? time : fuel;
+    }
+};
 
-            // Combined maneuver
-            if (i < N && j < N) {
-                double H2 = H_grid[i + 1];
-                double V2 = V_grid[j + 1];
-                SegmentData seg = calculate_combined(H1, H2, V1, V2, current_mass, criterion);
+class StateGrid {
+private:
+    int rows, cols;
+    vector<GridNode> nodes;
+
+public:
+    StateGrid() : rows(0), cols(0) {}
+
+    // Resets every node to the unreached state, at the scenario's takeoff mass.
+    // The buffer is only reallocated when the grid grows, so one StateGrid can
+    // serve many solves.
+    void reset(int n_rows, int n_cols, double takeoff_mass) {
+        GridNode unreached;
+        unreached.time = UNREACHED;
+        unreached.fuel = UNREACHED;
+        unreached.mass = takeoff_mass;
+        unreached.prev = -1;
+        unreached.maneuver = ACCELERATION;
+
+        rows = n_rows;
+        cols = n_cols;
+        nodes.assign(static_cast<size_t>(rows) * cols, unreached);
+    }
 
-                if (seg.valid) {
-                    double new_mass = current_mass - seg.fuel;
-                    if (new_mass < TU134_MASS * 0.85) continue;
+    int index(int i, int j) const { return i * cols + j; }
+    GridNode& at(int i, int j) { return nodes[index(i, j)]; }
+    const GridNode& at(int i, int j) const { return nodes[index(i, j)]; }
+    const GridNode& at(int idx) const { return nodes[idx]; }
 
-                    double cost_inc = (criterion == MIN_TIME) ? seg.time : seg.fuel;
-                    double new_cost = cost[i][j] + cost_inc;
+    int getRows() const { return rows; }
+    int getCols() const { return cols; }
+};
 
-                    if (new_cost < cost[i + 1][j + 1]) {
-                        cost[i + 1][j + 1] = new_cost;
-                        time[i + 1][j + 1] = time[i][j] + seg.time;
-                        fuel[i + 1][j + 1] = fuel[i][j] + seg.fuel;
-                        mass[i + 1][j + 1] = new_mass;
-                        prev_i[i + 1][j + 1] = i;
-                        prev_j[i + 1][j + 1] = j;
-                        maneuver[i + 1][j + 1] = COMBINED;
-                    }
-                }
-            }
+// Sparse grid over a corridor of the full (NH + 1) x (NV + 1) grid: row i
+// holds only columns lo[i]..hi[i]. prev keeps full-grid flat indices, so a
+// path backtracks the same way as on a StateGrid.
+class CorridorGrid {
+private:
+    int rows, cols;
+    vector<int> lo, hi;
+    vector<size_t> offset;
+    vector<GridNode> nodes;
+
+public:
+    CorridorGrid() : rows(0), cols(0) {}
+
+    // A row with hi < lo is empty: it holds no nodes and contains no column
+    void reset(int n_cols, const vector<int>& row_lo, const vector<int>& row_hi, double takeoff_mass) {
+        GridNode unreached;
+        unreached.time = UNREACHED;
+        unreached.fuel = UNREACHED;
+        unreached.mass = takeoff_mass;
+        unreached.prev = -1;
+        unreached.maneuver = ACCELERATION;
+
+        rows = (int)row_lo.size();
+        cols = n_cols;
+        lo = row_lo;
+        hi = row_hi;
+        offset.resize(rows);
+        size_t size = 0;
+        for (int i = 0; i < rows; i++) {
+            offset[i] = size;
+            if (hi[i] >= lo[i]) size += (size_t)(hi[i] - lo[i] + 1);
         }
+        nodes.assign(size, unreached);
     }
 
-    if (cost[N][N] >= 1e9) {
-        cout << "ERROR: No valid trajectory found!\n";
-        cout << "Try increasing thrust settings or using more gradual maneuvers.\n";
-        return trajectory;
-    }
+    bool contains(int i, int j) const { return i < rows && j >= lo[i] && j <= hi[i]; }
+    int index(int i, int j) const { return i * cols + j; }
+    GridNode& at(int i, int j) { return nodes[offset[i] + (j - lo[i])]; }
+    const GridNode& at(int i, int j) const { return nodes[offset[i] + (j - lo[i])]; }
+    const GridNode& at(int idx) const { return at(idx / cols, idx % cols); }
 
-    int ci = N, cj = N;
-    while (ci >= 0 && cj >= 0) {
-        trajectory.path.push_back(make_pair(H_grid[ci], V_grid[cj]));
-        trajectory.maneuvers.push_back(maneuver[ci][cj]);
-        trajectory.mass_points.push_back(mass[ci][cj]);
-        trajectory.fuel_points.push_back(fuel[ci][cj]);
-        trajectory.time_points.push_back(time[ci][cj]);
+    int rowLo(int i) const { return lo[i]; }
+    int rowHi(int i) const { return hi[i]; }
+    size_t size() const { return nodes.size(); }
+};
 
-        int pi = prev_i[ci][cj];
-        int pj = prev_j[ci][cj];
+// Buffers reused across solves
+struct SolverWorkspace {
+    StateGrid grid;
+    CorridorGrid corridor;
+    SegmentCostCache segments;
+};
 
-        if (pi == -1) break;
-        ci = pi;
-        cj = pj;
+// Backtracks the path that ends at (goal_i, goal_j) through the prev indices;
+// the scenario's altitudes give the average climb rate
+template <class Grid>
+TrajectoryResult trajectory_from_grid(const Grid& grid, const Scenario& scenario,
+                                      const vector<double>& H_grid, const vector<double>& V_grid,
+                                      int goal_i, int goal_j) {
+    TrajectoryResult trajectory;
+    const int NV = (int)V_grid.size() - 1;
+
+    int idx = grid.index(goal_i, goal_j);
+    while (idx >= 0) {
+        const GridNode& node = grid.at(idx);
+        trajectory.path.push_back(make_pair(H_grid[idx / (NV + 1)], V_grid[idx % (NV + 1)]));
+        trajectory.maneuvers.push_back(node.maneuver);
+        trajectory.mass_points.push_back(node.mass);
+        trajectory.fuel_points.push_back(node.fuel);
+        trajectory.time_points.push_back(node.time);
+        idx = node.prev;
     }
 
     reverse(trajectory.path.begin(), trajectory.path.end());
@@ -513,50 +1392,2104 @@ TrajectoryResult solve_trajectory_grid(OptimizationCriterion criterion) {
         else if (trajectory.maneuvers[k] == COMBINED) trajectory.used_combined++;
     }
 
-    trajectory.total_time = time[N][N];
-    trajectory.total_fuel = fuel[N][N];
-    trajectory.avg_climb_rate = (FINAL_ALTITUDE - INITIAL_ALTITUDE) / trajectory.total_time;
+    const GridNode& goal = grid.at(grid.index(goal_i, goal_j));
+    trajectory.total_time = goal.time;
+    trajectory.total_fuel = goal.fuel;
+    trajectory.avg_climb_rate = (scenario.final_altitude - scenario.initial_altitude)
+                              / trajectory.total_time;
+    return trajectory;
+}
 
-    cout << "Optimal trajectory:\n";
-    cout << "--------------------------------------------------------\n";
-    cout << "Point\tAltitude (m)\tVelocity (km/h)\tManeuver\n";
-    cout << "--------------------------------------------------------\n";
+template <class Grid>
+TrajectoryResult trajectory_from_grid(const Grid& grid, const Scenario& scenario,
+                                      const vector<double>& H_grid, const vector<double>& V_grid) {
+    return trajectory_from_grid(grid, scenario, H_grid, V_grid, scenario.NH, scenario.NV);
+}
 
-    for (size_t k = 0; k < trajectory.path.size(); k++) {
-        cout << k + 1 << "\t" << fixed << setprecision(0)
-             << setw(8) << trajectory.path[k].first
-             << "\t" << setw(12) << trajectory.path[k].second * 3.6;
+// ========== FORWARD SWEEP ==========
+// Cost of one outgoing edge that passed the mass floor check
+struct EdgeCost {
+    double time;
+    double fuel;
+    bool valid;
+};
 
-        if (k > 0) {
-            switch (trajectory.maneuvers[k]) {
-                case ACCELERATION: cout << "\t[Acceleration]"; break;
-                case CLIMB: cout << "\t[Climb]"; break;
-                case COMBINED: cout << "\t[Combined]"; break;
-            }
-        } else {
-            cout << "\t[Start]";
-        }
-        cout << "\n";
+// Outgoing edges of one cell
+struct CellEdges {
+    EdgeCost accel;    // to (i, j + 1)
+    EdgeCost climb;    // to (i + 1, j)
+    EdgeCost combined; // to (i + 1, j + 1)
+};
+
+// Stores a valid segment as an edge. Returns false if the segment breaks the
+// mass floor: the remaining edges of the cell are then dropped as well.
+inline bool accept_edge(double mass_floor, double mass, bool valid, double time, double fuel,
+                        EdgeCost& edge, int reason = REJECT_NONE) {
+    edges_evaluated_here++;
+    PROFILE_EDGE(valid, reason);
+    if (!valid) return true;
+    if (mass - fuel < mass_floor) {
+        PROFILE_COUNT(rejected[REJECT_MASS_FLOOR]);
+        return false;
+    }
+    edge.time = time;
+    edge.fuel = fuel;
+    edge.valid = true;
+    return true;
+}
+
+// Evaluates the outgoing edges of cell (i, j) with the scalar kernels.
+// Returns false if an edge broke the mass floor and cut the rest.
+template <OptimizationCriterion C>
+bool evaluate_edges(const Scenario& scenario,
+                    const SegmentTable& table,
+                    const vector<double>& H_grid, const vector<double>& V_grid,
+                    int i, int j, const GridNode& node, CellEdges& edges) {
+    edges.accel.valid = false;
+    edges.climb.valid = false;
+    edges.combined.valid = false;
+    if (node.cost<C>() >= UNREACHED) return true;
+
+    double H1 = H_grid[i];
+    double V1 = V_grid[j];
+    double current_mass = node.mass;
+
+    auto accept = [&](const SegmentData& seg, EdgeCost& edge) {
+        return accept_edge(scenario.massFloor(), current_mass, seg.valid, seg.time, seg.fuel, edge,
+                           seg.reason);
+    };
+
+    // Acceleration only
+    if (j < scenario.NV) {
+        SegmentData seg = calculate_acceleration<C>(table.accel[i], V1, V_grid[j + 1],
+                                                    current_mass);
+        if (!accept(seg, edges.accel)) return false;
     }
 
-    cout << "\n=============================================\n";
-    cout << "Maneuvers used:\n";
-    cout << "- Acceleration: " << trajectory.used_acceleration << " times\n";
-    cout << "- Climb: " << trajectory.used_climb << " times\n";
-    cout << "- Combined: " << trajectory.used_combined << " times\n";
-    cout << "------------------------------------------------\n";
-    cout << fixed << setprecision(1);
-    cout << "Total time: " << trajectory.total_time << " s ("
-         << trajectory.total_time / 60.0 << " min)\n";
-    cout << "Total fuel: " << trajectory.total_fuel << " kg\n";
-    cout << "Average climb rate: " << trajectory.avg_climb_rate
-         << " m/s (" << trajectory.avg_climb_rate * 60.0 << " m/min)\n";
-    cout << "=============================================\n";
+    // Climb only
+    if (i < scenario.NH) {
+        SegmentData seg = calculate_climb<C>(table.climb[i], H1, H_grid[i + 1], V1,
+                                             current_mass);
+        if (!accept(seg, edges.climb)) return false;
+    }
 
-    return trajectory;
+    // Combined maneuver
+    if (i < scenario.NH && j < scenario.NV) {
+        SegmentData seg = calculate_combined<C>(table.combined[i], H1, H_grid[i + 1], V1, V_grid[j + 1],
+                                                current_mass, scenario);
+        if (!accept(seg, edges.combined)) return false;
+    }
+    return true;
+}
+
+template <OptimizationCriterion C>
+inline void relax_edge(const GridNode& from, int from_idx, const EdgeCost& edge, ManeuverType type,
+                       GridNode& to) {
+    if (!edge.valid) return;
+    PROFILE_COUNT(relaxations);
+
+    double cost_inc = (C == MIN_TIME) ? edge.time : edge.fuel;
+    double new_cost = from.cost<C>() + cost_inc;
+
+    if (new_cost < to.cost<C>()) {
+        PROFILE_COUNT(improvements);
+        to.time = from.time + edge.time;
+        to.fuel = from.fuel + edge.fuel;
+        to.mass = from.mass - edge.fuel;
+        to.prev = from_idx;
+        to.maneuver = type;
+    }
+}
+
+bool evaluate_edges(OptimizationCriterion criterion, const Scenario& scenario,
+                    const SegmentTable& table,
+                    const vector<double>& H_grid, const vector<double>& V_grid,
+                    int i, int j, const GridNode& node, CellEdges& edges) {
+    return criterion == MIN_TIME
+        ? evaluate_edges<MIN_TIME>(scenario, table, H_grid, V_grid, i, j, node, edges)
+        : evaluate_edges<MIN_FUEL>(scenario, table, H_grid, V_grid, i, j, node, edges);
+}
+
+inline void relax_edge(OptimizationCriterion criterion, const GridNode& from, int from_idx,
+                       const EdgeCost& edge, ManeuverType type, GridNode& to) {
+    if (criterion == MIN_TIME) {
+        relax_edge<MIN_TIME>(from, from_idx, edge, type, to);
+    } else {
+        relax_edge<MIN_FUEL>(from, from_idx, edge, type, to);
+    }
+}
+
+// Row-by-row sweep. Acceleration edges stay inside the row and chain from one
+// cell to the next, so they are relaxed one at a time. Climb and combined
+// edges all lead to the next row and are evaluated for the whole row in one
+// batch. Every cell still receives its edges in row-major order.
+template <OptimizationCriterion C>
+void forward_sweep_serial(const Scenario& scenario, const SegmentTable& table,
+                          const vector<double>& H_grid, const vector<double>& V_grid,
+                          StateGrid& grid) {
+    const int NH = scenario.NH;
+    const int NV = scenario.NV;
+    const double mass_floor = scenario.massFloor();
+
+    SegmentBatch climb, combined;
+    vector<unsigned char> alive(NV + 1);
+
+    for (int i = 0; i <= NH; i++) {
+        // Acceleration along the row
+        for (int j = 0; j <= NV; j++) {
+            const GridNode& node = grid.at(i, j);
+            alive[j] = node.cost<C>() < UNREACHED;
+            if (!alive[j] || j == NV) continue;
+
+            SegmentData seg = calculate_acceleration<C>(table.accel[i], V_grid[j], V_grid[j + 1],
+                                                        node.mass);
+            EdgeCost edge;
+            edge.valid = false;
+            if (!accept_edge(mass_floor, node.mass, seg.valid, seg.time, seg.fuel, edge, seg.reason)) {
+                alive[j] = false;
+                continue;
+            }
+            relax_edge<C>(node, grid.index(i, j), edge, ACCELERATION, grid.at(i, j + 1));
+        }
+
+        if (i == NH) break;
+
+        // Climb and combined edges into row i + 1, one block of cells at a time.
+        // The last cell of the row gets V2 == V1, which calculate_combined rejects.
+        for (int j0 = 0; j0 <= NV; j0 += SEGMENT_BATCH_SIZE) {
+            int n = min(SEGMENT_BATCH_SIZE, NV + 1 - j0);
+            climb.count = combined.count = n;
+
+            for (int l = 0; l < n; l++) {
+                int j = j0 + l;
+                double mass = grid.at(i, j).mass;
+                double V2 = (j < NV) ? V_grid[j + 1] : V_grid[j];
+                climb.set(l, table.climb[i], H_grid[i], H_grid[i + 1], V_grid[j], V_grid[j], mass);
+                combined.set(l, table.combined[i], H_grid[i], H_grid[i + 1], V_grid[j], V2, mass);
+            }
+            calculate_climb_batch<C>(climb);
+            calculate_combined_batch<C>(combined, scenario);
+
+            for (int l = 0; l < n; l++) {
+                int j = j0 + l;
+                if (!alive[j]) continue;
+
+                const GridNode& node = grid.at(i, j);
+                int idx = grid.index(i, j);
+                EdgeCost edge;
+
+                edge.valid = false;
+                if (!accept_edge(mass_floor, node.mass, climb.valid[l], climb.time[l], climb.fuel[l],
+                                 edge, climb.reason[l])) continue;
+                relax_edge<C>(node, idx, edge, CLIMB, grid.at(i + 1, j));
+
+                edge.valid = false;
+                if (!accept_edge(mass_floor, node.mass, combined.valid[l], combined.time[l], combined.fuel[l],
+                                 edge, combined.reason[l])) continue;
+                if (edge.valid) {
+                    relax_edge<C>(node, idx, edge, COMBINED, grid.at(i + 1, j + 1));
+                }
+            }
+        }
+    }
+}
+
+// Barrier for the wavefront workers; diagonals are short, so spin instead of sleeping
+class SpinBarrier {
+private:
+    const unsigned count;
+    atomic<unsigned> waiting;
+    atomic<unsigned> generation;
+
+public:
+    explicit SpinBarrier(unsigned n) : count(n), waiting(0), generation(0) {}
+
+    void wait() {
+        unsigned gen = generation.load(memory_order_acquire);
+        if (waiting.fetch_add(1, memory_order_acq_rel) + 1 == count) {
+            waiting.store(0, memory_order_relaxed);
+            generation.fetch_add(1, memory_order_release);
+        } else {
+            while (generation.load(memory_order_acquire) == gen) {
+                this_thread::yield();
+            }
+        }
+    }
+};
+
+// Anti-diagonal sweep. Every edge goes from (i, j) to (i+1, j), (i, j+1) or
+// (i+1, j+1), so the cells of one diagonal i + j = k only depend on the two
+// previous diagonals and can be processed in parallel. Each cell pulls the
+// stored edges of its predecessors in the same order the row-major sweep
+// pushes them, which keeps the result bit-identical to forward_sweep_serial.
+// Acceleration edges go through the batched kernel here and the scalar one in
+// the serial sweep; both round identically unless the compiler is allowed to
+// fuse multiply-adds (GCC/Clang: -ffp-contract=off, MSVC: default /fp:precise).
+template <OptimizationCriterion C>
+void forward_sweep_wavefront(const Scenario& scenario, const SegmentTable& table,
+                             const vector<double>& H_grid, const vector<double>& V_grid,
+                             StateGrid& grid, unsigned threads) {
+    const int NH = scenario.NH;
+    const int NV = scenario.NV;
+    const double mass_floor = scenario.massFloor();
+
+    // Outgoing edges of the last three diagonals, indexed by row
+    vector<CellEdges> diag_edges[3];
+    for (int d = 0; d < 3; d++) diag_edges[d].resize(NH + 1);
+
+    SpinBarrier barrier(threads);
+
+    auto worker = [&](unsigned t) {
+        SegmentBatch accel, climb, combined;
+
+        for (int k = 0; k <= NH + NV; k++) {
+            int i_lo = max(0, k - NV);
+            int count = min(NH, k) - i_lo + 1;
+            int begin = i_lo + (int)((long long)count * t / threads);
+            int end = i_lo + (int)((long long)count * (t + 1) / threads);
+
+            vector<CellEdges>& out = diag_edges[k % 3];
+            const vector<CellEdges>& prev1 = diag_edges[(k + 2) % 3];
+            const vector<CellEdges>& prev2 = diag_edges[(k + 1) % 3];
+
+            for (int i = begin; i < end; i++) {
+                int j = k - i;
+                GridNode& node = grid.at(i, j);
+
+                if (i > 0 && j > 0) {
+                    relax_edge<C>(grid.at(i - 1, j - 1), grid.index(i - 1, j - 1),
+                               prev2[i - 1].combined, COMBINED, node);
+                }
+                if (i > 0) {
+                    relax_edge<C>(grid.at(i - 1, j), grid.index(i - 1, j),
+                               prev1[i - 1].climb, CLIMB, node);
+                }
+                if (j > 0) {
+                    relax_edge<C>(grid.at(i, j - 1), grid.index(i, j - 1),
+                               prev1[i].accel, ACCELERATION, node);
+                }
+            }
+
+            // Outgoing edges of the chunk, one block of cells at a time. Cells on
+            // the grid border get H2 == H1 or V2 == V1, which the kernels reject.
+            for (int b0 = begin; b0 < end; b0 += SEGMENT_BATCH_SIZE) {
+                int n = min(SEGMENT_BATCH_SIZE, end - b0);
+                accel.count = climb.count = combined.count = n;
+
+                for (int l = 0; l < n; l++) {
+                    int i = b0 + l;
+                    int j = k - i;
+                    int row = min(i, NH - 1);
+                    double mass = grid.at(i, j).mass;
+                    double H1 = H_grid[i];
+                    double H2 = (i < NH) ? H_grid[i + 1] : H1;
+                    double V1 = V_grid[j];
+                    double V2 = (j < NV) ? V_grid[j + 1] : V1;
+
+                    accel.set(l, table.accel[i], H1, H1, V1, V2, mass);
+                    climb.set(l, table.climb[row], H1, H2, V1, V1, mass);
+                    combined.set(l, table.combined[row], H1, H2, V1, V2, mass);
+                }
+                calculate_acceleration_batch<C>(accel);
+                calculate_climb_batch<C>(climb);
+                calculate_combined_batch<C>(combined, scenario);
+
+                for (int l = 0; l < n; l++) {
+                    int i = b0 + l;
+                    const GridNode& node = grid.at(i, k - i);
+                    CellEdges& edges = out[i];
+                    edges.accel.valid = false;
+                    edges.climb.valid = false;
+                    edges.combined.valid = false;
+                    if (node.cost<C>() >= UNREACHED) continue;
+
+                    if (!accept_edge(mass_floor, node.mass, accel.valid[l], accel.time[l], accel.fuel[l],
+                                     edges.accel, accel.reason[l])) continue;
+                    if (!accept_edge(mass_floor, node.mass, climb.valid[l], climb.time[l], climb.fuel[l],
+                                     edges.climb, climb.reason[l])) continue;
+                    accept_edge(mass_floor, node.mass, combined.valid[l], combined.time[l], combined.fuel[l],
+                                edges.combined, combined.reason[l]);
+                }
+            }
+
+            barrier.wait();
+        }
+        worker_edges_evaluated += edges_evaluated_here;
+        edges_evaluated_here = 0;
+        PROFILE_FLUSH();
+    };
+
+    vector<thread> pool;
+    for (unsigned t = 1; t < threads; t++) {
+        pool.emplace_back(worker, t);
+    }
+    worker(0);
+    for (thread& th : pool) {
+        th.join();
+    }
+}
+
+// ========== LABEL-SETTING SWEEPS ==========
+// Solvers that keep several labels per node (mass-aware state, Pareto front)
+// share one row-major sweep. A node's candidates are pruned once all its
+// predecessors are done; the survivors go to a pool that is kept for
+// backtracking, so memory grows with the labels actually reached rather than
+// with a dense cube.
+void build_grid_axes(const Scenario& scenario, vector<double>& H_grid, vector<double>& V_grid) {
+    double dH = scenario.stepH();
+    double dV = scenario.stepV();
+
+    H_grid.resize(scenario.NH + 1);
+    V_grid.resize(scenario.NV + 1);
+
+    for (int i = 0; i <= scenario.NH; i++) {
+        H_grid[i] = scenario.initial_altitude + i * dH;
+    }
+    for (int j = 0; j <= scenario.NV; j++) {
+        V_grid[j] = scenario.initial_velocity + j * dV;
+    }
+}
+
+struct PathLabel {
+    double time;
+    double fuel;
+    int parent;                      // index in the label pool, -1 at the start
+    int cell;                        // grid index of the node
+    ManeuverType maneuver;
+    OptimizationCriterion program;   // control program of the incoming edge
+};
+
+// Expands every label with each control program in turn; prune(candidates)
+// finalizes a node. Returns the pool index of the first goal label.
+template <class Prune>
+size_t sweep_labels(const Scenario& scenario, const vector<double>& H_grid, const vector<double>& V_grid,
+                    const OptimizationCriterion* programs, const SegmentTable* const* tables,
+                    int program_count, Prune prune, vector<PathLabel>& pool) {
+    const int NH = scenario.NH;
+    const int NV = scenario.NV;
+
+    // Candidates pushed into the current and the next row
+    vector<vector<PathLabel>> current(NV + 1), next(NV + 1);
+
+    PathLabel start;
+    start.time = 0;
+    start.fuel = 0;
+    start.parent = -1;
+    start.cell = 0;
+    start.maneuver = ACCELERATION;
+    start.program = programs[0];
+    current[0].push_back(start);
+
+    pool.clear();
+    size_t goal_begin = 0;
+    for (int i = 0; i <= NH; i++) {
+        for (int j = 0; j <= NV; j++) {
+            vector<PathLabel>& candidates = current[j];
+            prune(candidates);
+            size_t begin = pool.size();
+            pool.insert(pool.end(), candidates.begin(), candidates.end());
+            candidates.clear();
+            if (i == NH && j == NV) goal_begin = begin;
+
+            for (size_t l = begin; l < pool.size(); l++) {
+                GridNode node;
+                node.time = pool[l].time;
+                node.fuel = pool[l].fuel;
+                node.mass = scenario.takeoffMass() - pool[l].fuel;
+
+                for (int p = 0; p < program_count; p++) {
+                    CellEdges edges;
+                    evaluate_edges(programs[p], scenario, *tables[p], H_grid, V_grid, i, j, node, edges);
+
+                    auto push = [&](const EdgeCost& edge, ManeuverType type, vector<PathLabel>& to,
+                                    int cell) {
+                        if (!edge.valid) return;
+                        PathLabel label;
+                        label.time = node.time + edge.time;
+                        label.fuel = node.fuel + edge.fuel;
+                        label.parent = (int)l;
+                        label.cell = cell;
+                        label.maneuver = type;
+                        label.program = programs[p];
+                        to.push_back(label);
+                    };
+                    if (j < NV) push(edges.accel, ACCELERATION, current[j + 1], i * (NV + 1) + j + 1);
+                    if (i < NH) push(edges.climb, CLIMB, next[j], (i + 1) * (NV + 1) + j);
+                    if (i < NH && j < NV) {
+                        push(edges.combined, COMBINED, next[j + 1], (i + 1) * (NV + 1) + j + 1);
+                    }
+                }
+            }
+        }
+        current.swap(next);
+    }
+    return goal_begin;
+}
+
+// Backtracks from pool[goal]; programs, if given, receives the program
+// flown into each point
+TrajectoryResult trajectory_from_labels(const vector<PathLabel>& pool, size_t goal,
+                                        const Scenario& scenario,
+                                        const vector<double>& H_grid, const vector<double>& V_grid,
+                                        vector<OptimizationCriterion>* programs = nullptr) {
+    TrajectoryResult trajectory;
+    const int NV = scenario.NV;
+
+    for (int l = (int)goal; l >= 0; l = pool[l].parent) {
+        const PathLabel& label = pool[l];
+        trajectory.path.push_back(make_pair(H_grid[label.cell / (NV + 1)],
+                                            V_grid[label.cell % (NV + 1)]));
+        trajectory.maneuvers.push_back(label.maneuver);
+        trajectory.time_points.push_back(label.time);
+        trajectory.fuel_points.push_back(label.fuel);
+        trajectory.mass_points.push_back(scenario.takeoffMass() - label.fuel);
+        if (programs) programs->push_back(label.program);
+    }
+
+    reverse(trajectory.path.begin(), trajectory.path.end());
+    reverse(trajectory.maneuvers.begin(), trajectory.maneuvers.end());
+    reverse(trajectory.time_points.begin(), trajectory.time_points.end());
+    reverse(trajectory.fuel_points.begin(), trajectory.fuel_points.end());
+    reverse(trajectory.mass_points.begin(), trajectory.mass_points.end());
+    if (programs) reverse(programs->begin(), programs->end());
+
+    for (size_t k = 1; k < trajectory.maneuvers.size(); k++) {
+        if (trajectory.maneuvers[k] == ACCELERATION) trajectory.used_acceleration++;
+        else if (trajectory.maneuvers[k] == CLIMB) trajectory.used_climb++;
+        else if (trajectory.maneuvers[k] == COMBINED) trajectory.used_combined++;
+    }
+
+    trajectory.total_time = pool[goal].time;
+    trajectory.total_fuel = pool[goal].fuel;
+    trajectory.avg_climb_rate = (scenario.final_altitude - scenario.initial_altitude)
+                              / trajectory.total_time;
+    return trajectory;
+}
+
+// ========== MASS-AWARE STATE ==========
+// With scenario.mass_step > 0 a node keeps one label per bucket of burnt fuel
+// (i.e. of current mass) instead of a single mass: the segment physics of
+// later edges then sees every distinct mass that reached the node. Labels
+// that are both costlier and heavier than another one are dropped too, so
+// only reached, useful buckets are stored, and at most MASS_STATE_MAX_LABELS
+// of the cheapest survivors stay per node.
+//
+// With the built-in criteria this never changes the answer: the cost is the
+// burnt fuel (MIN_FUEL) or proportional to it at full thrust (MIN_TIME), so
+// the cheapest label is also the heaviest and the extra labels cannot win.
+// The mode checks that the single-mass sweep is exact (see the readme).
+const int MASS_STATE_MAX_LABELS = 16;
+
+void prune_mass_labels(vector<PathLabel>& labels, OptimizationCriterion criterion, double mass_step) {
+    auto cost = [criterion](const PathLabel& label) {
+        return (criterion == MIN_TIME) ? label.time : label.fuel;
+    };
+
+    // Cheapest label first; a label survives only if it is lighter (has
+    // burnt more fuel) than all cheaper survivors and opens a new bucket
+    sort(labels.begin(), labels.end(), [&](const PathLabel& a, const PathLabel& b) {
+        return cost(a) < cost(b) || (cost(a) == cost(b) && a.fuel > b.fuel);
+    });
+
+    // Survivors burn more and more fuel, so their buckets only increase
+    size_t kept = 0;
+    double max_fuel = -numeric_limits<double>::infinity();
+    long long last_bucket = 0;
+    for (size_t k = 0; k < labels.size() && kept < (size_t)MASS_STATE_MAX_LABELS; k++) {
+        if (labels[k].fuel <= max_fuel) continue;
+        long long bucket = (long long)floor(labels[k].fuel / mass_step);
+        if (kept > 0 && bucket == last_bucket) continue;
+        last_bucket = bucket;
+        max_fuel = labels[k].fuel;
+        labels[kept++] = labels[k];
+    }
+    labels.resize(kept);
+}
+
+TrajectoryResult solve_mass_state(OptimizationCriterion criterion, const Scenario& scenario,
+                                  SolverWorkspace& workspace) {
+    vector<double> H_grid, V_grid;
+    build_grid_axes(scenario, H_grid, V_grid);
+    const SegmentTable* table = &workspace.segments.lookup(criterion, scenario, H_grid);
+
+    vector<PathLabel> pool;
+    size_t goal_begin = sweep_labels(scenario, H_grid, V_grid, &criterion, &table, 1,
+                                     [&](vector<PathLabel>& labels) {
+                                         prune_mass_labels(labels, criterion, scenario.mass_step);
+                                     },
+                                     pool);
+
+    // Survivors are sorted by cost: the first goal label is the optimum
+    if (goal_begin >= pool.size()) return TrajectoryResult();
+    return trajectory_from_labels(pool, goal_begin, scenario, H_grid, V_grid);
+}
+
+// ========== CORRIDOR REFINEMENT ==========
+// With scenario.refine = r > 1 the grid is solved coarse-to-fine: a dense
+// solve on a grid about r^k times coarser, then at every finer level (r
+// times finer each, ending at NH x NV) only a corridor of cells around the
+// previous optimal path. If the new path runs along the corridor edge the
+// corridor is widened around it and the level is solved again.
+const int CORRIDOR_COARSE_MIN = 16; // smallest dimension of the coarsest level
+const int CORRIDOR_HALO = 2;        // corridor half-width, in coarse cells
+const int CORRIDOR_MAX_WIDEN = 3;   // re-solves per level while the path hugs the edge
+
+// Scalar push sweep over the corridor; arrivals happen in the same order as
+// in forward_sweep_serial, so a full-width corridor gives the same result
+void forward_sweep_corridor(OptimizationCriterion criterion, const Scenario& scenario,
+                            const SegmentTable& table,
+                            const vector<double>& H_grid, const vector<double>& V_grid,
+                            CorridorGrid& grid) {
+    for (int i = 0; i <= scenario.NH; i++) {
+        for (int j = grid.rowLo(i); j <= grid.rowHi(i); j++) {
+            const GridNode& node = grid.at(i, j);
+            CellEdges edges;
+            evaluate_edges(criterion, scenario, table, H_grid, V_grid, i, j, node, edges);
+
+            int from = grid.index(i, j);
+            if (grid.contains(i, j + 1)) {
+                relax_edge(criterion, node, from, edges.accel, ACCELERATION, grid.at(i, j + 1));
+            }
+            if (grid.contains(i + 1, j)) {
+                relax_edge(criterion, node, from, edges.climb, CLIMB, grid.at(i + 1, j));
+            }
+            if (grid.contains(i + 1, j + 1)) {
+                relax_edge(criterion, node, from, edges.combined, COMBINED, grid.at(i + 1, j + 1));
+            }
+        }
+    }
+}
+
+// Rows of the corridor around a path given as (i, j) cells of an NHc x NVc
+// grid, on an NHf x NVf grid: every cell of the boxes between consecutive
+// path points, widened by halo cells in both directions
+void corridor_around_path(const vector<pair<int, int>>& cells, int NHc, int NVc, int NHf, int NVf,
+                          int halo, vector<int>& lo, vector<int>& hi) {
+    vector<int> path_lo(NHf + 1, NVf + 1), path_hi(NHf + 1, -1);
+    auto map_i = [&](int i) { return (int)(((long long)i * NHf + NHc / 2) / NHc); };
+    auto map_j = [&](int j) { return (int)(((long long)j * NVf + NVc / 2) / NVc); };
+
+    for (size_t k = 0; k < cells.size(); k++) {
+        const pair<int, int>& a = cells[k];
+        const pair<int, int>& b = cells[k + 1 < cells.size() ? k + 1 : k];
+        for (int i = map_i(a.first); i <= map_i(b.first); i++) {
+            path_lo[i] = min(path_lo[i], map_j(a.second));
+            path_hi[i] = max(path_hi[i], map_j(b.second));
+        }
+    }
+
+    lo.assign(NHf + 1, NVf);
+    hi.assign(NHf + 1, 0);
+    for (int i = 0; i <= NHf; i++) {
+        if (path_hi[i] < 0) continue;
+        for (int r = max(0, i - halo); r <= min(NHf, i + halo); r++) {
+            lo[r] = min(lo[r], max(0, path_lo[i] - halo));
+            hi[r] = max(hi[r], min(NVf, path_hi[i] + halo));
+        }
+    }
+}
+
+// Solves one level on the corridor in workspace.corridor; returns the
+// optimal path as grid cells, empty if the goal is not reached
+vector<pair<int, int>> solve_corridor_level(OptimizationCriterion criterion, const Scenario& level,
+                                            SolverWorkspace& workspace,
+                                            const vector<int>& lo, const vector<int>& hi,
+                                            vector<double>& H_grid, vector<double>& V_grid) {
+    build_grid_axes(level, H_grid, V_grid);
+    const SegmentTable& table = workspace.segments.lookup(criterion, level, H_grid);
+
+    CorridorGrid& grid = workspace.corridor;
+    grid.reset(level.NV + 1, lo, hi, level.takeoffMass());
+    GridNode& start = grid.at(0, 0);
+    start.time = 0;
+    start.fuel = 0;
+    start.mass = level.takeoffMass();
+
+    forward_sweep_corridor(criterion, level, table, H_grid, V_grid, grid);
+
+    vector<pair<int, int>> cells;
+    if (grid.at(level.NH, level.NV).cost(criterion) >= UNREACHED) return cells;
+    for (int idx = grid.index(level.NH, level.NV); idx >= 0; idx = grid.at(idx).prev) {
+        cells.push_back(make_pair(idx / (level.NV + 1), idx % (level.NV + 1)));
+    }
+    reverse(cells.begin(), cells.end());
+    return cells;
+}
+
+TrajectoryResult solve_trajectory_refined(OptimizationCriterion criterion, const Scenario& scenario,
+                                          SolverWorkspace& workspace) {
+    // Level sizes from the finest down
+    vector<pair<int, int>> levels(1, make_pair(scenario.NH, scenario.NV));
+    while (min(levels.back().first, levels.back().second) / scenario.refine >= CORRIDOR_COARSE_MIN) {
+        levels.push_back(make_pair((levels.back().first + scenario.refine - 1) / scenario.refine,
+                                   (levels.back().second + scenario.refine - 1) / scenario.refine));
+    }
+    reverse(levels.begin(), levels.end());
+
+    Scenario level = scenario;
+    level.refine = 0;
+    level.NH = levels[0].first;
+    level.NV = levels[0].second;
+
+    vector<double> H_grid, V_grid;
+    vector<int> lo(level.NH + 1, 0), hi(level.NH + 1, level.NV);
+    vector<pair<int, int>> path = solve_corridor_level(criterion, level, workspace, lo, hi, H_grid, V_grid);
+    if (path.empty()) return TrajectoryResult();
+
+    for (size_t k = 1; k < levels.size(); k++) {
+        int NHc = level.NH, NVc = level.NV;
+        level.NH = levels[k].first;
+        level.NV = levels[k].second;
+        int halo = CORRIDOR_HALO * max((level.NH + NHc - 1) / NHc, (level.NV + NVc - 1) / NVc);
+
+        vector<pair<int, int>> center = path;
+        for (int attempt = 0; ; attempt++) {
+            corridor_around_path(center, NHc, NVc, level.NH, level.NV, halo, lo, hi);
+            path = solve_corridor_level(criterion, level, workspace, lo, hi, H_grid, V_grid);
+            if (attempt == CORRIDOR_MAX_WIDEN) break;
+
+            if (!path.empty()) {
+                bool on_edge = false;
+                for (const pair<int, int>& cell : path) {
+                    int i = cell.first, j = cell.second;
+                    if ((j == lo[i] && j > 0) || (j == hi[i] && j < level.NV)) on_edge = true;
+                }
+                if (!on_edge) break;
+
+                // Recentre on the new path at this level
+                center = path;
+                NHc = level.NH;
+                NVc = level.NV;
+            }
+            halo *= 2;
+        }
+
+        if (path.empty()) {
+            // Unreachable inside every corridor: solve the whole level
+            lo.assign(level.NH + 1, 0);
+            hi.assign(level.NH + 1, level.NV);
+            path = solve_corridor_level(criterion, level, workspace, lo, hi, H_grid, V_grid);
+            if (path.empty()) return TrajectoryResult();
+        }
+    }
+
+    return trajectory_from_grid(workspace.corridor, level, H_grid, V_grid);
+}
+
+// ========== BEST-FIRST SEARCH ==========
+// With scenario.best_first the graph is searched A*-style from the start
+// instead of sweeping every cell: nodes are expanded in order of cost so far
+// plus a lower bound of the cost to go, and the search stops when the goal
+// is expanded. Regions that are unreachable or clearly too expensive are
+// never costed.
+//
+// Lower bounds hold for every edge of the kernels: a climb or combined edge
+// gains height at most at the capped vertical speed, an acceleration or
+// combined edge gains speed at most at thrust_x / (lightest mass), and every
+// edge burns at least the smallest fuel flow of the table. The bound is
+// consistent (no edge costs less than the drop of the bound across it), so
+// a node is normally final the first time it is expanded. Rounding can still
+// lower a node's cost after that; it is then expanded again.
+//
+// The result is the sweep's to the last bit: a node takes an edge of equal
+// cost only from a predecessor with a lower flat index, the one the sweep
+// relaxes first, and the search goes on until no open estimate is below or
+// equal to the goal's cost.
+struct SearchBound {
+    double climb_rate_max; // m/s
+    double accel_max;      // m/s^2
+    double fuel_flow_min;  // kg/s
+
+    SearchBound(OptimizationCriterion criterion, const Scenario& scenario, const SegmentTable& table) {
+        climb_rate_max = (criterion == MIN_TIME) ? MAX_VERTICAL_SPEED * 1.2 : MAX_VERTICAL_SPEED;
+
+        double thrust_x_max = 0;
+        fuel_flow_min = numeric_limits<double>::infinity();
+        for (const SegmentRow& row : table.accel) {
+            thrust_x_max = max(thrust_x_max, row.thrust_x);
+            fuel_flow_min = min(fuel_flow_min, row.fuel_flow);
+        }
+        for (size_t i = 0; i < table.combined.size(); i++) {
+            thrust_x_max = max(thrust_x_max, table.combined[i].thrust_x);
+            fuel_flow_min = min(fuel_flow_min, min(table.combined[i].fuel_flow, table.climb[i].fuel_flow));
+        }
+        // MIN_FUEL combined edges may raise a small positive dV/dt to 0.003
+        accel_max = max(thrust_x_max / scenario.massFloor(), 0.003);
+        fuel_flow_min = max(fuel_flow_min, 0.0);
+    }
+
+    // Shrunk slightly so that rounding never lifts it above a true cost
+    double costToGo(OptimizationCriterion criterion, double dH, double dV) const {
+        double time = max(dH / climb_rate_max, dV / accel_max) * (1.0 - 1e-9);
+        return (criterion == MIN_TIME) ? time : time * fuel_flow_min;
+    }
+};
+
+// Nodes the search has reached, in pages of SEARCH_PAGE cells of a row that
+// are allocated on first touch: memory follows the explored region instead
+// of the grid, and a lookup stays two array accesses
+const int SEARCH_PAGE = 64;
+
+class SearchGrid {
+private:
+    struct Slot {
+        GridNode node;
+        unsigned version; // bumped on every update; older heap entries are stale
+    };
+
+    int cols, pages_per_row;
+    Slot unreached;
+    vector<vector<Slot>> pages;
+    size_t touched;
+
+public:
+    SearchGrid(int n_rows, int n_cols, double takeoff_mass)
+        : cols(n_cols), pages_per_row((n_cols + SEARCH_PAGE - 1) / SEARCH_PAGE),
+          pages((size_t)n_rows * pages_per_row), touched(0) {
+        unreached.node.time = UNREACHED;
+        unreached.node.fuel = UNREACHED;
+        unreached.node.mass = takeoff_mass;
+        unreached.node.prev = -1;
+        unreached.node.maneuver = ACCELERATION;
+        unreached.version = 0;
+    }
+
+    int index(int i, int j) const { return i * cols + j; }
+
+    GridNode& at(int i, int j, unsigned*& version) {
+        vector<Slot>& page = pages[(size_t)i * pages_per_row + j / SEARCH_PAGE];
+        if (page.empty()) {
+            page.assign(SEARCH_PAGE, unreached);
+            touched++;
+        }
+        Slot& slot = page[j % SEARCH_PAGE];
+        version = &slot.version;
+        return slot.node;
+    }
+
+    const GridNode& at(int i, int j) const {
+        const vector<Slot>& page = pages[(size_t)i * pages_per_row + j / SEARCH_PAGE];
+        return page.empty() ? unreached.node : page[j % SEARCH_PAGE].node;
+    }
+    const GridNode& at(int idx) const { return at(idx / cols, idx % cols); }
+
+    // Cells held in allocated pages
+    size_t size() const { return touched * SEARCH_PAGE; }
+};
+
+struct SearchEntry {
+    double estimate; // cost so far + bound to go
+    double cost;
+    int idx;
+    unsigned version;
+
+    // Min-heap on the estimate; ties go to the deeper node
+    bool operator<(const SearchEntry& other) const {
+        if (estimate != other.estimate) return estimate > other.estimate;
+        return cost < other.cost;
+    }
+};
+
+// expanded, if given, receives the number of expanded nodes
+TrajectoryResult solve_trajectory_best_first(OptimizationCriterion criterion, const Scenario& scenario,
+                                             SolverWorkspace& workspace, size_t* expanded = nullptr) {
+    const int NH = scenario.NH;
+    const int NV = scenario.NV;
+
+    vector<double> H_grid, V_grid;
+    build_grid_axes(scenario, H_grid, V_grid);
+
+    SearchGrid grid(NH + 1, NV + 1, scenario.takeoffMass());
+    const SegmentTable& table = workspace.segments.lookup(criterion, scenario, H_grid);
+    SearchBound bound(criterion, scenario, table);
+
+    unsigned* version;
+    GridNode& start = grid.at(0, 0, version);
+    start.time = 0;
+    start.fuel = 0;
+
+    auto estimate = [&](int i, int j, double cost) {
+        return cost + bound.costToGo(criterion, H_grid[NH] - H_grid[i], V_grid[NV] - V_grid[j]);
+    };
+
+    priority_queue<SearchEntry> open;
+    open.push({estimate(0, 0, 0), 0, 0, 0});
+    size_t expanded_nodes = 0;
+    const int goal = grid.index(NH, NV);
+    unsigned* goal_version;
+    const GridNode& goal_node = grid.at(NH, NV, goal_version); // pages never move
+
+    while (!open.empty()) {
+        SearchEntry entry = open.top();
+        if (entry.estimate > goal_node.cost(criterion)) break;
+        open.pop();
+
+        int i = entry.idx / (NV + 1);
+        int j = entry.idx % (NV + 1);
+        GridNode& node = grid.at(i, j, version);
+        if (entry.version != *version) continue;
+        expanded_nodes++;
+        if (entry.idx == goal) continue;
+
+        CellEdges edges;
+        evaluate_edges(criterion, scenario, table, H_grid, V_grid, i, j, node, edges);
+
+        auto relax = [&](const EdgeCost& edge, ManeuverType type, int ti, int tj) {
+            if (!edge.valid) return;
+            unsigned* to_version;
+            GridNode& to = grid.at(ti, tj, to_version);
+            double cost = node.cost(criterion) + (criterion == MIN_TIME ? edge.time : edge.fuel);
+            // Equal costs go to the predecessor the sweep relaxes first
+            if (cost < to.cost(criterion) || (cost == to.cost(criterion) && entry.idx < to.prev)) {
+                to.time = UNREACHED;
+                to.fuel = UNREACHED;
+                relax_edge(criterion, node, entry.idx, edge, type, to);
+                ++*to_version;
+                open.push({estimate(ti, tj, to.cost(criterion)), to.cost(criterion), grid.index(ti, tj),
+                           *to_version});
+            }
+        };
+        if (j < NV) relax(edges.accel, ACCELERATION, i, j + 1);
+        if (i < NH) relax(edges.climb, CLIMB, i + 1, j);
+        if (i < NH && j < NV) relax(edges.combined, COMBINED, i + 1, j + 1);
+    }
+
+    if (expanded) *expanded = expanded_nodes;
+    if (goal_node.cost(criterion) >= UNREACHED) return TrajectoryResult();
+    return trajectory_from_grid(grid, scenario, H_grid, V_grid);
+}
+
+// ========== JUMP STENCILS ==========
+// With scenario.jump = k > 1 a cell also connects to cells up to k steps away
+// in H and V with one combined segment, so paths are no longer limited to
+// staircases of unit steps. A jump that is a multiple of a shorter one,
+// e.g. (2, 2) = 2 x (1, 1), only repeats a straight line the shorter move
+// already covers and is left out; the stencil keeps the moves with coprime
+// offsets (k = 2: 5 moves, k = 3: 9 moves instead of 15).
+struct StencilMove {
+    int di; // altitude steps
+    int dj; // velocity steps
+};
+
+int greatest_common_divisor(int a, int b) {
+    while (b != 0) {
+        int r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+vector<StencilMove> build_stencil(int jump) {
+    vector<StencilMove> moves;
+    // Unit moves first, in the order the sweep tries them
+    moves.push_back({0, 1});
+    moves.push_back({1, 0});
+    moves.push_back({1, 1});
+    for (int di = 1; di <= jump; di++) {
+        for (int dj = 1; dj <= jump; dj++) {
+            if ((di == 1 && dj == 1) || greatest_common_divisor(di, dj) != 1) continue;
+            moves.push_back({di, dj});
+        }
+    }
+    return moves;
+}
+
+// Scalar push sweep over the stencil in row-major order. The mass floor
+// rule is the sweep's: once an edge of a cell breaks it, the remaining
+// moves of that cell are dropped.
+TrajectoryResult solve_trajectory_stencil(OptimizationCriterion criterion, const Scenario& scenario,
+                                          SolverWorkspace& workspace) {
+    const int NH = scenario.NH;
+    const int NV = scenario.NV;
+    const double mass_floor = scenario.massFloor();
+
+    vector<double> H_grid, V_grid;
+    build_grid_axes(scenario, H_grid, V_grid);
+
+    StateGrid& grid = workspace.grid;
+    grid.reset(NH + 1, NV + 1, scenario.takeoffMass());
+    const SegmentTable& table = workspace.segments.lookup(criterion, scenario, H_grid);
+    const vector<StencilMove> moves = build_stencil(scenario.jump);
+
+    GridNode& start = grid.at(0, 0);
+    start.time = 0;
+    start.fuel = 0;
+    start.mass = scenario.takeoffMass();
+
+    for (int i = 0; i <= NH; i++) {
+        for (int j = 0; j <= NV; j++) {
+            const GridNode& node = grid.at(i, j);
+            if (node.cost(criterion) >= UNREACHED) continue;
+
+            for (const StencilMove& move : moves) {
+                int ti = i + move.di;
+                int tj = j + move.dj;
+                if (ti > NH || tj > NV) continue;
+
+                SegmentData seg;
+                ManeuverType type = COMBINED;
+                if (move.di == 0) {
+                    type = ACCELERATION;
+                    seg = calculate_acceleration(table.accel[i], V_grid[j], V_grid[tj], node.mass, criterion);
+                } else if (move.dj == 0) {
+                    type = CLIMB;
+                    seg = calculate_climb(table.climb[i], H_grid[i], H_grid[ti], V_grid[j],
+                                          node.mass, criterion);
+                } else {
+                    // Row at the midpoint altitude: between two grid rows for
+                    // odd jumps, on a grid row for even ones
+                    int half = 2 * i + move.di;
+                    const SegmentRow& row = (half % 2) ? table.combined[half / 2]
+                                                       : table.combined_at_rows[half / 2];
+                    seg = calculate_combined(row, H_grid[i], H_grid[ti], V_grid[j], V_grid[tj],
+                                             node.mass, criterion, scenario);
+                }
+
+                EdgeCost edge;
+                edge.valid = false;
+                if (!accept_edge(mass_floor, node.mass, seg.valid, seg.time, seg.fuel, edge, seg.reason)) break;
+                relax_edge(criterion, node, grid.index(i, j), edge, type, grid.at(ti, tj));
+            }
+        }
+    }
+
+    if (grid.at(NH, NV).cost(criterion) >= UNREACHED) return TrajectoryResult();
+    return trajectory_from_grid(grid, scenario, H_grid, V_grid);
+}
+
+// ========== CONTROL OPTIMIZATION ==========
+// With scenario.optimal_controls every edge is flown with the angle of attack
+// and throttle that minimize its cost instead of the fixed schedule of
+// getAlphaForCriterion and getThrustSetting. Every kernel gets faster with
+// more thrust, so MIN_TIME keeps full throttle and searches the angle only;
+// MIN_FUEL searches both. The search is a sweep over a few candidates,
+// refined by golden-section search around the best one. The scheduled
+// controls are a candidate too, so the memoized row never costs more than the
+// schedule for the reference edge it was searched for (the block's centre at
+// the bucket's mass); other edges of the block may do slightly worse.
+//
+// rowLiftForce never lets lift drop below 0.8 m g, whatever the angle of
+// attack, while drag keeps falling with the angle. Searched candidates must
+// therefore make that lift on the wing over the whole edge, or the search would
+// pick small angles for lift the model grants for free.
+//
+// Controls are memoized per block of grid cells (CONTROL_BLOCK_H by
+// CONTROL_BLOCK_V, or one cell on coarser grids) and per CONTROL_MASS_BUCKET
+// of burnt fuel, and found for a unit edge from the centre of the block.
+// The number of searches therefore stops growing once the grid is finer
+// than a block, and the sweep itself costs one table lookup more per edge.
+const double CONTROL_BLOCK_H = 200.0;          // m
+const double CONTROL_BLOCK_V = 10.0 / 3.6;     // m/s
+const double CONTROL_MASS_BUCKET = 500.0;      // kg
+const double CONTROL_ALPHA_MIN = 1.0 * M_PI / 180.0;
+const double CONTROL_ALPHA_MAX = 8.0 * M_PI / 180.0;
+const double CONTROL_THROTTLE_MIN = 0.5;
+const int CONTROL_ALPHA_CANDIDATES = 8;
+const int CONTROL_THROTTLE_CANDIDATES = 6;
+const int CONTROL_GOLDEN_STEPS = 10;
+
+// Golden-section search for the minimum of f on [lo, hi]; updates x_best
+// and best_cost if it finds a lower cost
+template <class F>
+void golden_section_refine(F f, double lo, double hi, double& x_best, double& best_cost) {
+    const double r = 0.5 * (sqrt(5.0) - 1.0);
+    double x1 = hi - r * (hi - lo);
+    double x2 = lo + r * (hi - lo);
+    double f1 = f(x1);
+    double f2 = f(x2);
+    for (int k = 0; k < CONTROL_GOLDEN_STEPS; k++) {
+        if (f1 < f2) {
+            hi = x2;
+            x2 = x1;
+            f2 = f1;
+            x1 = hi - r * (hi - lo);
+            f1 = f(x1);
+        } else {
+            lo = x1;
+            x1 = x2;
+            f1 = f2;
+            x2 = lo + r * (hi - lo);
+            f2 = f(x2);
+        }
+    }
+    if (f1 < best_cost) {
+        best_cost = f1;
+        x_best = x1;
+    }
+    if (f2 < best_cost) {
+        best_cost = f2;
+        x_best = x2;
+    }
+}
+
+// Row with the controls that minimize the cost of the edge (H1, V1) -> (H2, V2)
+template <OptimizationCriterion C, ManeuverType M, class Aircraft>
+SegmentRow optimize_segment_controls(const Aircraft& aircraft, const Scenario& scenario,
+                                     double H1, double H2, double V1, double V2, double mass) {
+    SegmentRow row;
+    double H_row = (M == ACCELERATION) ? H1 : 0.5 * (H1 + H2);
+    double rho, a_sound;
+    atmosphere(H_row, rho, a_sound);
+    row.half_rho = 0.5 * rho;
+
+    auto edge_cost = [&](double alpha, double thrust_setting) {
+        set_segment_controls(row, aircraft, alpha, thrust_setting, scenario.thrust_fraction);
+        SegmentData seg = (M == ACCELERATION) ? calculate_acceleration<C>(row, V1, V2, mass)
+                        : (M == CLIMB) ? calculate_climb<C>(row, H1, H2, V1, mass)
+                        : calculate_combined<C>(row, H1, H2, V1, V2, mass, scenario);
+        if (!seg.valid) return UNREACHED;
+        return (C == MIN_TIME) ? seg.time : seg.fuel;
+    };
+    // Searched candidates only; lift grows with speed, so the slower end decides
+    auto cost = [&](double alpha, double thrust_setting) {
+        double c = edge_cost(alpha, thrust_setting);
+        return rowLiftFloorActive(row, min(V1, V2), mass) ? UNREACHED : c;
+    };
+
+    double alpha, throttle;
+    schedule_controls<C, M>(H_row, scenario, alpha, throttle);
+    double best = edge_cost(alpha, throttle);
+
+    const double alpha_step = (CONTROL_ALPHA_MAX - CONTROL_ALPHA_MIN) / (CONTROL_ALPHA_CANDIDATES - 1);
+    const double throttle_step = (1.0 - CONTROL_THROTTLE_MIN) / (CONTROL_THROTTLE_CANDIDATES - 1);
+    const int throttles = (C == MIN_TIME) ? 1 : CONTROL_THROTTLE_CANDIDATES;
+    for (int t = 0; t < throttles; t++) {
+        double candidate_throttle = 1.0 - t * throttle_step;
+        for (int a = 0; a < CONTROL_ALPHA_CANDIDATES; a++) {
+            double candidate_alpha = CONTROL_ALPHA_MIN + a * alpha_step;
+            double c = cost(candidate_alpha, candidate_throttle);
+            if (c < best) {
+                best = c;
+                alpha = candidate_alpha;
+                throttle = candidate_throttle;
+            }
+        }
+    }
+
+    if (best < UNREACHED) {
+        const double fixed_throttle = throttle;
+        golden_section_refine([&](double x) { return cost(x, fixed_throttle); },
+                              max(alpha - alpha_step, CONTROL_ALPHA_MIN),
+                              min(alpha + alpha_step, CONTROL_ALPHA_MAX), alpha, best);
+        if (C == MIN_FUEL) {
+            const double fixed_alpha = alpha;
+            golden_section_refine([&](double x) { return cost(fixed_alpha, x); },
+                                  max(throttle - throttle_step, CONTROL_THROTTLE_MIN),
+                                  min(throttle + throttle_step, 1.0), throttle, best);
+        }
+    }
+
+    set_segment_controls(row, aircraft, alpha, throttle, scenario.thrust_fraction);
+    return row;
+}
+
+// Optimized rows of one solve, searched on first use. The rows hold the
+// control terms only: the sweep sets half_rho for the edge's own altitude.
+class ControlCache {
+private:
+    int block_h, block_v, blocks_h, blocks_v, mass_buckets;
+    double takeoff_mass;
+    vector<SegmentRow> rows;     // maneuver, mass bucket, block row, block column
+    vector<unsigned char> ready;
+
+public:
+    ControlCache() : block_h(1), block_v(1), blocks_h(0), blocks_v(0), mass_buckets(0),
+                     takeoff_mass(0) {}
+
+    void reset(const Scenario& scenario) {
+        block_h = max(1, (int)(CONTROL_BLOCK_H / scenario.stepH() + 0.5));
+        block_v = max(1, (int)(CONTROL_BLOCK_V / scenario.stepV() + 0.5));
+        blocks_h = scenario.NH / block_h + 1;
+        blocks_v = scenario.NV / block_v + 1;
+        takeoff_mass = scenario.takeoffMass();
+        mass_buckets = (int)((takeoff_mass - scenario.massFloor()) / CONTROL_MASS_BUCKET) + 1;
+        size_t size = 3 * (size_t)mass_buckets * blocks_h * blocks_v;
+        rows.resize(size);
+        ready.assign(size, 0);
+    }
+
+    template <OptimizationCriterion C, ManeuverType M, class Aircraft>
+    const SegmentRow& lookup(const Aircraft& aircraft, const Scenario& scenario, int i, int j,
+                             double mass) {
+        int bi = i / block_h;
+        int bj = j / block_v;
+        int bucket = min(max((int)((takeoff_mass - mass) / CONTROL_MASS_BUCKET), 0), mass_buckets - 1);
+        size_t key = (((size_t)(M - 1) * mass_buckets + bucket) * blocks_h + bi) * blocks_v + bj;
+        if (!ready[key]) {
+            double dH = scenario.stepH();
+            double dV = scenario.stepV();
+            double H1 = scenario.initial_altitude + (bi * block_h + 0.5 * (block_h - 1)) * dH;
+            double V1 = scenario.initial_velocity + (bj * block_v + 0.5 * (block_v - 1)) * dV;
+            double bucket_mass = takeoff_mass - (bucket + 0.5) * CONTROL_MASS_BUCKET;
+            rows[key] = optimize_segment_controls<C, M>(aircraft, scenario, H1, H1 + dH, V1, V1 + dV,
+                                                        bucket_mass);
+            ready[key] = 1;
+        }
+        return rows[key];
+    }
+};
+
+// Row-major sweep, every cell's edges in the order of forward_sweep_serial
+template <OptimizationCriterion C, class Aircraft>
+void forward_sweep_controls(const Aircraft& aircraft, const Scenario& scenario,
+                            const vector<double>& H_grid, const vector<double>& V_grid,
+                            ControlCache& controls, StateGrid& grid) {
+    const int NH = scenario.NH;
+    const int NV = scenario.NV;
+    const double mass_floor = scenario.massFloor();
+
+    // Air density at the rows and between them
+    vector<double> half_rho(NH + 1), half_rho_mid(NH);
+    for (int i = 0; i <= NH; i++) {
+        double rho, a_sound;
+        atmosphere(H_grid[i], rho, a_sound);
+        half_rho[i] = 0.5 * rho;
+        if (i < NH) {
+            atmosphere(0.5 * (H_grid[i] + H_grid[i + 1]), rho, a_sound);
+            half_rho_mid[i] = 0.5 * rho;
+        }
+    }
+
+    for (int i = 0; i <= NH; i++) {
+        for (int j = 0; j <= NV; j++) {
+            const GridNode& node = grid.at(i, j);
+            if (node.cost<C>() >= UNREACHED) continue;
+            int from = grid.index(i, j);
+            SegmentRow row;
+            EdgeCost edge;
+
+            if (j < NV) {
+                row = controls.lookup<C, ACCELERATION>(aircraft, scenario, i, j, node.mass);
+                row.half_rho = half_rho[i];
+                SegmentData seg = calculate_acceleration<C>(row, V_grid[j], V_grid[j + 1], node.mass);
+                edge.valid = false;
+                if (!accept_edge(mass_floor, node.mass, seg.valid, seg.time, seg.fuel, edge, seg.reason)) continue;
+                relax_edge<C>(node, from, edge, ACCELERATION, grid.at(i, j + 1));
+            }
+            if (i == NH) continue;
+
+            row = controls.lookup<C, CLIMB>(aircraft, scenario, i, j, node.mass);
+            row.half_rho = half_rho_mid[i];
+            SegmentData seg = calculate_climb<C>(row, H_grid[i], H_grid[i + 1], V_grid[j], node.mass);
+            edge.valid = false;
+            if (!accept_edge(mass_floor, node.mass, seg.valid, seg.time, seg.fuel, edge, seg.reason)) continue;
+            relax_edge<C>(node, from, edge, CLIMB, grid.at(i + 1, j));
+
+            if (j == NV) continue;
+            row = controls.lookup<C, COMBINED>(aircraft, scenario, i, j, node.mass);
+            row.half_rho = half_rho_mid[i];
+            seg = calculate_combined<C>(row, H_grid[i], H_grid[i + 1], V_grid[j], V_grid[j + 1],
+                                        node.mass, scenario);
+            edge.valid = false;
+            if (!accept_edge(mass_floor, node.mass, seg.valid, seg.time, seg.fuel, edge, seg.reason)) continue;
+            relax_edge<C>(node, from, edge, COMBINED, grid.at(i + 1, j + 1));
+        }
+    }
+}
+
+template <OptimizationCriterion C>
+void forward_sweep_controls(const Scenario& scenario, const vector<double>& H_grid,
+                            const vector<double>& V_grid, ControlCache& controls, StateGrid& grid) {
+    with_aircraft(scenario, [&](const auto& aircraft) {
+        forward_sweep_controls<C>(aircraft, scenario, H_grid, V_grid, controls, grid);
+    });
+}
+
+TrajectoryResult solve_trajectory_controls(OptimizationCriterion criterion, const Scenario& scenario,
+                                           SolverWorkspace& workspace) {
+    const int NH = scenario.NH;
+    const int NV = scenario.NV;
+
+    vector<double> H_grid, V_grid;
+    build_grid_axes(scenario, H_grid, V_grid);
+
+    StateGrid& grid = workspace.grid;
+    grid.reset(NH + 1, NV + 1, scenario.takeoffMass());
+    ControlCache controls;
+    controls.reset(scenario);
+
+    GridNode& start = grid.at(0, 0);
+    start.time = 0;
+    start.fuel = 0;
+    start.mass = scenario.takeoffMass();
+
+    if (criterion == MIN_TIME) {
+        forward_sweep_controls<MIN_TIME>(scenario, H_grid, V_grid, controls, grid);
+    } else {
+        forward_sweep_controls<MIN_FUEL>(scenario, H_grid, V_grid, controls, grid);
+    }
+
+    if (grid.at(NH, NV).cost(criterion) >= UNREACHED) return TrajectoryResult();
+    return trajectory_from_grid(grid, scenario, H_grid, V_grid);
+}
+
+// ========== GRID-BASED OPTIMIZATION ==========
+// Pure solver: no console output, an empty path means no feasible trajectory.
+// threads = 0 uses all hardware threads; more than the hardware has or than
+// a diagonal has cells are not started
+TrajectoryResult solve_trajectory_grid(OptimizationCriterion criterion, const Scenario& scenario,
+                                       SolverWorkspace& workspace, unsigned threads = 0) {
+    scenario.validate();
+    if (scenario.mass_step > 0) return solve_mass_state(criterion, scenario, workspace);
+    if (scenario.refine > 1) return solve_trajectory_refined(criterion, scenario, workspace);
+    if (scenario.best_first) return solve_trajectory_best_first(criterion, scenario, workspace);
+    if (scenario.jump > 1) return solve_trajectory_stencil(criterion, scenario, workspace);
+    if (scenario.optimal_controls) return solve_trajectory_controls(criterion, scenario, workspace);
+
+    const int NH = scenario.NH;
+    const int NV = scenario.NV;
+
+    vector<double> H_grid, V_grid;
+    build_grid_axes(scenario, H_grid, V_grid);
+
+    StateGrid& grid = workspace.grid;
+    grid.reset(NH + 1, NV + 1, scenario.takeoffMass());
+    const SegmentTable& table = workspace.segments.lookup(criterion, scenario, H_grid);
+
+    GridNode& start = grid.at(0, 0);
+    start.time = 0;
+    start.fuel = 0;
+    start.mass = scenario.takeoffMass();
+
+    // Extra workers would only spin at the barrier of every diagonal
+    const unsigned hardware = max(1u, thread::hardware_concurrency());
+    if (threads == 0) threads = hardware;
+    threads = min(threads, min(hardware, (unsigned)min(NH, NV) + 1));
+
+    if (threads > 1 && min(NH, NV) >= WAVEFRONT_MIN_SIZE) {
+        if (criterion == MIN_TIME) {
+            forward_sweep_wavefront<MIN_TIME>(scenario, table, H_grid, V_grid, grid, threads);
+        } else {
+            forward_sweep_wavefront<MIN_FUEL>(scenario, table, H_grid, V_grid, grid, threads);
+        }
+    } else {
+        if (criterion == MIN_TIME) {
+            forward_sweep_serial<MIN_TIME>(scenario, table, H_grid, V_grid, grid);
+        } else {
+            forward_sweep_serial<MIN_FUEL>(scenario, table, H_grid, V_grid, grid);
+        }
+    }
+
+    const GridNode& goal = grid.at(NH, NV);
+    if (goal.cost(criterion) >= UNREACHED) {
+        return TrajectoryResult();
+    }
+
+    return trajectory_from_grid(grid, scenario, H_grid, V_grid);
+}
+
+// ========== PERSISTENT SOLVER ==========
+// Keeps the forward grid of one criterion between queries. The cost of a
+// node depends only on the paths that reach it, so once the grid is swept any
+// node can be the target: a new target costs one backtrack instead of a new
+// sweep. Targets beyond the grid extend it. Edges only go up in H and V,
+// so the old cells stay final, and only the new cells and the old border are
+// swept.
+//
+// The angle-of-attack and throttle schedules stay tied to the altitudes of
+// the scenario the solver was built for. solve_trajectory_grid with a
+// different final altitude would stretch them, so its costs differ slightly
+// from a query. Targets snap to the nearest node of the solver's grid.
+class PersistentSolver {
+private:
+    OptimizationCriterion criterion;
+    Scenario schedule; // the scenario the solver was built for
+    Scenario extent;   // the same, sized to the current grid
+    double dH, dV;
+    vector<double> H_grid, V_grid;
+    StateGrid grid;
+    SegmentCostCache segments;
+
+    template <OptimizationCriterion C>
+    void sweepFull() {
+        const SegmentTable& table = segments.lookup(criterion, schedule, H_grid);
+        grid.reset(extent.NH + 1, extent.NV + 1, extent.takeoffMass());
+        GridNode& start = grid.at(0, 0);
+        start.time = 0;
+        start.fuel = 0;
+        start.mass = schedule.takeoffMass();
+        forward_sweep_serial<C>(extent, table, H_grid, V_grid, grid);
+    }
+
+    // Sweeps the cells with i >= old_NH or j >= old_NV in row-major order, so
+    // every new cell receives its edges in the same order as in a full sweep.
+    // A border cell gains outgoing edges; if one of them breaks the mass floor
+    // it drops edges that the old sweep relaxed, so fall back to a full sweep.
+    template <OptimizationCriterion C>
+    void sweepExtension(int old_NH, int old_NV) {
+        const SegmentTable& table = segments.lookup(criterion, schedule, H_grid);
+        CellEdges edges;
+        for (int i = 0; i <= extent.NH; i++) {
+            for (int j = (i >= old_NH) ? 0 : old_NV; j <= extent.NV; j++) {
+                const GridNode& node = grid.at(i, j);
+                bool complete = evaluate_edges<C>(extent, table, H_grid, V_grid, i, j, node, edges);
+                if (!complete && i <= old_NH && j <= old_NV) {
+                    sweepFull<C>();
+                    return;
+                }
+                int from = grid.index(i, j);
+                if (j < extent.NV) relax_edge<C>(node, from, edges.accel, ACCELERATION, grid.at(i, j + 1));
+                if (i < extent.NH) relax_edge<C>(node, from, edges.climb, CLIMB, grid.at(i + 1, j));
+                if (i < extent.NH && j < extent.NV) {
+                    relax_edge<C>(node, from, edges.combined, COMBINED, grid.at(i + 1, j + 1));
+                }
+            }
+        }
+    }
+
+    void snap(double final_altitude, double final_velocity, int& i, int& j) const {
+        double di = floor((final_altitude - schedule.initial_altitude) / dH + 0.5);
+        double dj = floor((final_velocity - schedule.initial_velocity) / dV + 0.5);
+        if (!(di >= 0) || !(dj >= 0) || (di == 0 && dj == 0)) {
+            throw invalid_argument("target must be above or faster than the start");
+        }
+        if (di > numeric_limits<int>::max() - 1 || dj > numeric_limits<int>::max() - 1) {
+            throw invalid_argument("target is out of range");
+        }
+        i = (int)di;
+        j = (int)dj;
+    }
+
+public:
+    // Plain grid solves only: no mass state, refinement, A*, jump stencils or
+    // optimal controls
+    PersistentSolver(OptimizationCriterion criterion, const Scenario& scenario)
+        : criterion(criterion), schedule(scenario), extent(scenario) {
+        scenario.validate();
+        if (!scenario.plainGrid()) {
+            throw invalid_argument("the persistent solver supports the plain grid sweep only");
+        }
+        dH = scenario.stepH();
+        dV = scenario.stepV();
+        build_grid_axes(scenario, H_grid, V_grid);
+        if (criterion == MIN_TIME) sweepFull<MIN_TIME>();
+        else sweepFull<MIN_FUEL>();
+    }
+
+    int rows() const { return extent.NH; }
+    int cols() const { return extent.NV; }
+
+    // Grows the grid to at least NH x NV steps, keeping the swept cells
+    void extend(int NH, int NV) {
+        int old_NH = extent.NH;
+        int old_NV = extent.NV;
+        NH = max(NH, old_NH);
+        NV = max(NV, old_NV);
+        if (NH == old_NH && NV == old_NV) return;
+        if ((long long)(NH + 1) * (NV + 1) > MAX_GRID_NODES) {
+            throw invalid_argument("grid size " + to_string(NH) + " x " + to_string(NV)
+                                   + " is out of range");
+        }
+
+        StateGrid old_grid;
+        swap(old_grid, grid);
+        grid.reset(NH + 1, NV + 1, extent.takeoffMass());
+        for (int i = 0; i <= old_NH; i++) {
+            for (int j = 0; j <= old_NV; j++) {
+                GridNode node = old_grid.at(i, j);
+                if (node.prev >= 0) {
+                    node.prev = grid.index(node.prev / (old_NV + 1), node.prev % (old_NV + 1));
+                }
+                grid.at(i, j) = node;
+            }
+        }
+
+        H_grid.resize(NH + 1);
+        V_grid.resize(NV + 1);
+        for (int i = old_NH + 1; i <= NH; i++) H_grid[i] = schedule.initial_altitude + i * dH;
+        for (int j = old_NV + 1; j <= NV; j++) V_grid[j] = schedule.initial_velocity + j * dV;
+        extent.NH = NH;
+        extent.NV = NV;
+        extent.final_altitude = H_grid[NH];
+        extent.final_velocity = V_grid[NV];
+
+        if (criterion == MIN_TIME) sweepExtension<MIN_TIME>(old_NH, old_NV);
+        else sweepExtension<MIN_FUEL>(old_NH, old_NV);
+    }
+
+    // Scenario that a query for this target answers: the target snapped to
+    // the grid, with the solver's step sizes
+    Scenario targetScenario(double final_altitude, double final_velocity) const {
+        int i, j;
+        snap(final_altitude, final_velocity, i, j);
+        Scenario target = schedule;
+        target.NH = i;
+        target.NV = j;
+        target.final_altitude = schedule.initial_altitude + i * dH;
+        target.final_velocity = schedule.initial_velocity + j * dV;
+        return target;
+    }
+
+    // Optimal path to the target; empty if the target node is unreachable
+    TrajectoryResult query(double final_altitude, double final_velocity) {
+        int i, j;
+        snap(final_altitude, final_velocity, i, j);
+        if (i > extent.NH || j > extent.NV) extend(i, j);
+
+        if (grid.at(i, j).cost(criterion) >= UNREACHED) return TrajectoryResult();
+        return trajectory_from_grid(grid, targetScenario(final_altitude, final_velocity),
+                                    H_grid, V_grid, i, j);
+    }
+};
+
+// ========== COST-TO-GO TABLE ==========
+// Backward sweep from the target: cost[i][j] is the cheapest cost from node
+// (i, j) to the final state, policy[i][j] the first maneuver of that path.
+// A guidance loop that finds the aircraft off the nominal path looks up the
+// next maneuver in O(1) instead of solving again.
+//
+// Segment costs depend on the mass, which is not part of the state: every
+// node is flown with the mass the forward sweep brought to it (the takeoff
+// mass where the forward sweep did not get), so the table is exact along the
+// nominal mass profile. Costs are stored as float and the policy as one byte,
+// 5 bytes per node. The backward sweep uses the unit-step edges with the
+// scheduled controls, so only plain grid scenarios are accepted: with mass
+// state, refinement, A*, jump stencils or optimal controls the solver's
+// trajectory would not follow the table's policy.
+const unsigned char NO_MANEUVER = 0;
+
+class CostToGoTable {
+private:
+    OptimizationCriterion criterion;
+    int NH, NV;
+    double H0, V0, dH, dV;
+    vector<float> cost;
+    vector<unsigned char> policy;
+
+    template <OptimizationCriterion C>
+    void sweepBackward(const Scenario& scenario) {
+        vector<double> H_grid, V_grid;
+        build_grid_axes(scenario, H_grid, V_grid);
+        SegmentTable table;
+        fill_segment_table<C>(table, scenario, H_grid);
+
+        // Forward sweep for the node masses
+        StateGrid grid;
+        grid.reset(NH + 1, NV + 1, scenario.takeoffMass());
+        GridNode& start = grid.at(0, 0);
+        start.time = 0;
+        start.fuel = 0;
+        start.mass = scenario.takeoffMass();
+        forward_sweep_serial<C>(scenario, table, H_grid, V_grid, grid);
+
+        // Rows i + 1 (above) and i (current) of cost-to-go in double precision
+        vector<double> above(NV + 1, UNREACHED), row(NV + 1, UNREACHED);
+        CellEdges edges;
+        for (int i = NH; i >= 0; i--) {
+            for (int j = NV; j >= 0; j--) {
+                double best = UNREACHED;
+                unsigned char first = NO_MANEUVER;
+                if (i == NH && j == NV) {
+                    best = 0;
+                } else {
+                    GridNode node = grid.at(i, j);
+                    if (node.cost<C>() >= UNREACHED) {
+                        node.time = 0;
+                        node.fuel = 0;
+                        node.mass = scenario.takeoffMass();
+                    }
+                    evaluate_edges<C>(scenario, table, H_grid, V_grid, i, j, node, edges);
+
+                    auto consider = [&](const EdgeCost& edge, double to_go, ManeuverType type) {
+                        if (!edge.valid || to_go >= UNREACHED) return;
+                        double total = ((C == MIN_TIME) ? edge.time : edge.fuel) + to_go;
+                        if (total < best) {
+                            best = total;
+                            first = (unsigned char)type;
+                        }
+                    };
+                    if (j < NV) consider(edges.accel, row[j + 1], ACCELERATION);
+                    if (i < NH) consider(edges.climb, above[j], CLIMB);
+                    if (i < NH && j < NV) consider(edges.combined, above[j + 1], COMBINED);
+                }
+                row[j] = best;
+                cost[index(i, j)] = (float)best;
+                policy[index(i, j)] = first;
+            }
+            swap(above, row);
+        }
+    }
+
+    int index(int i, int j) const { return i * (NV + 1) + j; }
+
+    // Grid coordinates of a state, clamped to the table
+    void locate(double H, double V, double& x, double& y) const {
+        x = min(max((H - H0) / dH, 0.0), (double)NH);
+        y = min(max((V - V0) / dV, 0.0), (double)NV);
+    }
+
+public:
+    CostToGoTable() : criterion(MIN_TIME), NH(0), NV(0), H0(0), V0(0), dH(1), dV(1) {}
+
+    CostToGoTable(OptimizationCriterion criterion, const Scenario& scenario)
+        : criterion(criterion), NH(scenario.NH), NV(scenario.NV),
+          H0(scenario.initial_altitude), V0(scenario.initial_velocity),
+          dH(scenario.stepH()), dV(scenario.stepV()) {
+        scenario.validate();
+        if (!scenario.plainGrid()) {
+            throw invalid_argument("cost-to-go tables support the plain grid sweep only");
+        }
+        // Dense over the whole grid, whatever the scenario's solver would allocate
+        if (scenario.nodeCount() > MAX_GRID_NODES) {
+            throw invalid_argument("grid size " + to_string(NH) + " x " + to_string(NV)
+                                   + " is too large for a cost-to-go table");
+        }
+        cost.assign((size_t)(NH + 1) * (NV + 1), (float)UNREACHED);
+        policy.assign(cost.size(), NO_MANEUVER);
+        if (criterion == MIN_TIME) sweepBackward<MIN_TIME>(scenario);
+        else sweepBackward<MIN_FUEL>(scenario);
+    }
+
+    OptimizationCriterion getCriterion() const { return criterion; }
+    int rows() const { return NH; }
+    int cols() const { return NV; }
+    double nodeCost(int i, int j) const { return cost[index(i, j)]; }
+
+    // Cost to the target from altitude H (m) and velocity V (m/s), bilinear
+    // between the four surrounding nodes. Nodes that cannot reach the target
+    // are left out; UNREACHED if none of them can.
+    double costToGo(double H, double V) const {
+        double x, y;
+        locate(H, V, x, y);
+        int i = min((int)x, max(NH - 1, 0));
+        int j = min((int)y, max(NV - 1, 0));
+        double fx = x - i, fy = y - j;
+
+        double weight[4] = {(1 - fx) * (1 - fy), (1 - fx) * fy, fx * (1 - fy), fx * fy};
+        int corner[4] = {index(i, j), index(i, min(j + 1, NV)),
+                         index(min(i + 1, NH), j), index(min(i + 1, NH), min(j + 1, NV))};
+        double sum = 0, total = 0;
+        for (int k = 0; k < 4; k++) {
+            if (cost[corner[k]] >= (float)UNREACHED) continue;
+            sum += weight[k] * cost[corner[k]];
+            total += weight[k];
+        }
+        return total > 0 ? sum / total : UNREACHED;
+    }
+
+    // Next maneuver from the nearest node; false if that node cannot reach
+    // the target
+    bool nextManeuver(double H, double V, ManeuverType& maneuver) const {
+        double x, y;
+        locate(H, V, x, y);
+        unsigned char first = policy[index((int)(x + 0.5), (int)(y + 0.5))];
+        if (first == NO_MANEUVER) return false;
+        maneuver = (ManeuverType)first;
+        return true;
+    }
+
+    // Binary layout (native byte order): "HWCTG1\0\0", criterion, NH, NV as
+    // int32, H0, V0, dH, dV as double, then the costs and the policy row-major
+    void save(const string& file) const {
+        ofstream out(file.c_str(), ios::binary);
+        if (!out) throw runtime_error("cannot open cost-to-go file " + file);
+        const char magic[8] = {'H', 'W', 'C', 'T', 'G', '1', 0, 0};
+        int32_t header[3] = {(int32_t)criterion, (int32_t)NH, (int32_t)NV};
+        double axes[4] = {H0, V0, dH, dV};
+        out.write(magic, sizeof(magic));
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(axes), sizeof(axes));
+        out.write(reinterpret_cast<const char*>(cost.data()), cost.size() * sizeof(float));
+        out.write(reinterpret_cast<const char*>(policy.data()), policy.size());
+        if (!out) throw runtime_error("cannot write cost-to-go file " + file);
+    }
+
+    void load(const string& file) {
+        ifstream in(file.c_str(), ios::binary);
+        if (!in) throw runtime_error("cannot open cost-to-go file " + file);
+        char magic[8];
+        int32_t header[3];
+        double axes[4];
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char*>(header), sizeof(header));
+        in.read(reinterpret_cast<char*>(axes), sizeof(axes));
+        if (!in || memcmp(magic, "HWCTG1\0\0", 8) != 0 ||
+            (header[0] != MIN_TIME && header[0] != MIN_FUEL) || header[1] < 1 || header[2] < 1 ||
+            ((long long)header[1] + 1) * ((long long)header[2] + 1) > MAX_GRID_NODES) {
+            throw runtime_error(file + ": not a cost-to-go table");
+        }
+        criterion = (OptimizationCriterion)header[0];
+        NH = header[1];
+        NV = header[2];
+        H0 = axes[0];
+        V0 = axes[1];
+        dH = axes[2];
+        dV = axes[3];
+        cost.resize((size_t)(NH + 1) * (NV + 1));
+        policy.resize(cost.size());
+        in.read(reinterpret_cast<char*>(cost.data()), cost.size() * sizeof(float));
+        in.read(reinterpret_cast<char*>(policy.data()), policy.size());
+        if (!in) throw runtime_error(file + ": truncated cost-to-go table");
+    }
+};
+
+// ========== REFERENCE TRAJECTORY ==========
+// A solved path sampled at a fixed rate for a guidance loop. The kernels hold
+// dV/dt and Vy constant over a segment, so H and V are linear in time between
+// nodes, the flight path angle follows sin(theta) = Vy / V(t), and the angle
+// of attack and throttle are those the segment was flown with: the fixed
+// schedule, or with optimal controls the rows of the same ControlCache lookup
+// the sweep made. One pass over the samples, one control lookup per segment.
+const double REFERENCE_RATE = 50.0; // Hz
+
+struct ReferenceTrajectory {
+    double rate;              // samples per second
+    vector<double> time;      // s, sample k at k / rate
+    vector<double> altitude;  // m
+    vector<double> velocity;  // m/s
+    vector<double> theta;     // flight path angle, rad
+    vector<double> throttle;  // share of the available thrust
+    vector<double> alpha;     // angle of attack, rad
+
+    ReferenceTrajectory() : rate(REFERENCE_RATE) {}
+
+    size_t size() const { return time.size(); }
+};
+
+// Fills out, reusing its storage: samples from 0 to the last multiple of
+// 1 / rate before the end of the path
+template <OptimizationCriterion C, class Aircraft>
+void resample_trajectory(const Aircraft& aircraft, const TrajectoryResult& traj,
+                         const Scenario& scenario, double rate, ReferenceTrajectory& out) {
+    size_t samples = traj.path.empty() ? 0 : (size_t)(traj.total_time * rate) + 1;
+    out.rate = rate;
+    out.time.resize(samples);
+    out.altitude.resize(samples);
+    out.velocity.resize(samples);
+    out.theta.resize(samples);
+    out.throttle.resize(samples);
+    out.alpha.resize(samples);
+    if (samples == 0) return;
+
+    ControlCache controls;
+    if (scenario.optimal_controls) controls.reset(scenario);
+    const double phi_p = aircraft.engine_angle * M_PI / 180.0;
+    const double available_thrust = aircraft.nominal_thrust * scenario.thrust_fraction;
+
+    // Segment path[k] -> path[k + 1]
+    const size_t last = traj.path.size() - 1;
+    size_t k = 0;
+    double H1 = traj.path[0].first, V1 = traj.path[0].second, t1 = 0;
+    double Vy = 0, dV_dt = 0, alpha = 0, throttle = 0;
+    bool level = true;
+
+    auto enter = [&](size_t segment) {
+        k = segment;
+        H1 = traj.path[k].first;
+        V1 = traj.path[k].second;
+        t1 = traj.time_points[k];
+        double dt = traj.time_points[k + 1] - t1;
+        Vy = (traj.path[k + 1].first - H1) / dt;
+        dV_dt = (traj.path[k + 1].second - V1) / dt;
+
+        ManeuverType maneuver = traj.maneuvers[k + 1];
+        level = maneuver == ACCELERATION;
+        double H_row = level ? H1 : 0.5 * (H1 + traj.path[k + 1].first);
+        if (scenario.optimal_controls) {
+            int i = (int)lround((H1 - scenario.initial_altitude) / scenario.stepH());
+            int j = (int)lround((V1 - scenario.initial_velocity) / scenario.stepV());
+            double mass = traj.mass_points[k];
+            const SegmentRow& row =
+                maneuver == ACCELERATION ? controls.lookup<C, ACCELERATION>(aircraft, scenario, i, j, mass)
+                : maneuver == CLIMB ? controls.lookup<C, CLIMB>(aircraft, scenario, i, j, mass)
+                : controls.lookup<C, COMBINED>(aircraft, scenario, i, j, mass);
+            alpha = atan2(row.thrust_y, row.thrust_x) - phi_p;
+            throttle = row.thrust / available_thrust;
+        } else if (maneuver == ACCELERATION) {
+            schedule_controls<C, ACCELERATION>(H_row, scenario, alpha, throttle);
+        } else if (maneuver == CLIMB) {
+            schedule_controls<C, CLIMB>(H_row, scenario, alpha, throttle);
+        } else {
+            schedule_controls<C, COMBINED>(H_row, scenario, alpha, throttle);
+        }
+    };
+    if (last > 0) enter(0);
+
+    for (size_t n = 0; n < samples; n++) {
+        double t = n / rate;
+        if (k + 1 < last && t >= traj.time_points[k + 1]) {
+            size_t segment = k + 1;
+            while (segment + 1 < last && t >= traj.time_points[segment + 1]) segment++;
+            enter(segment);
+        }
+        double tau = t - t1;
+        double V = V1 + dV_dt * tau;
+        out.time[n] = t;
+        out.altitude[n] = H1 + Vy * tau;
+        out.velocity[n] = V;
+        out.theta[n] = level ? 0.0 : asin(min(1.0, Vy / V));
+        out.throttle[n] = throttle;
+        out.alpha[n] = alpha;
+    }
+}
+
+template <class Aircraft>
+void resample_trajectory(const Aircraft& aircraft, const TrajectoryResult& traj,
+                         OptimizationCriterion criterion, const Scenario& scenario, double rate,
+                         ReferenceTrajectory& out) {
+    if (criterion == MIN_TIME) resample_trajectory<MIN_TIME>(aircraft, traj, scenario, rate, out);
+    else resample_trajectory<MIN_FUEL>(aircraft, traj, scenario, rate, out);
+}
+
+// traj: solved for criterion and scenario
+void resample_trajectory(const TrajectoryResult& traj, OptimizationCriterion criterion,
+                         const Scenario& scenario, ReferenceTrajectory& out,
+                         double rate = REFERENCE_RATE) {
+    with_aircraft(scenario, [&](const auto& aircraft) {
+        resample_trajectory(aircraft, traj, criterion, scenario, rate, out);
+    });
+}
+
+void write_reference_csv(ostream& out, const ReferenceTrajectory& reference) {
+    out << setprecision(numeric_limits<double>::max_digits10);
+    out << "time_s,altitude_m,velocity_kmh,theta_deg,throttle,alpha_deg\n";
+    for (size_t n = 0; n < reference.size(); n++) {
+        out << reference.time[n] << "," << reference.altitude[n] << ","
+            << reference.velocity[n] * 3.6 << "," << reference.theta[n] * 180.0 / M_PI << ","
+            << reference.throttle[n] << "," << reference.alpha[n] * 180.0 / M_PI << "\n";
+    }
+}
+
+// ========== PARETO FRONT (TIME VS FUEL) ==========
+// Every edge may be flown with either control program (the minimum-time or
+// the minimum-fuel alpha/thrust law), and each node keeps all non-dominated
+// (time, fuel) labels instead of a single best cost. The goal labels are the
+// front of climb profiles, from fastest to most economical.
+//
+// Edge costs depend on the current mass, i.e. on the fuel already burnt, so
+// dropping a dominated label is the same approximation the single-criterion
+// sweep makes when it keeps one label per node.
+//
+// Memory is bounded by a cap on labels per node rather than by an epsilon
+// margin: on fine grids the fuel savings of one step are tiny, and epsilon
+// pruning repeated over hundreds of steps cuts off the economical end.
+const int PARETO_MAX_LABELS = 32;
+
+struct ParetoProfile {
+    TrajectoryResult trajectory;
+    vector<OptimizationCriterion> programs; // program flown into each point
+};
+
+// Keeps the non-dominated labels; if more than max_labels remain, an evenly
+// spaced subset that keeps both ends of the front is taken.
+void prune_labels(vector<PathLabel>& labels, int max_labels) {
+    sort(labels.begin(), labels.end(), [](const PathLabel& a, const PathLabel& b) {
+        return a.time < b.time || (a.time == b.time && a.fuel < b.fuel);
+    });
+
+    size_t kept = 0;
+    double best_fuel = numeric_limits<double>::infinity();
+    for (size_t k = 0; k < labels.size(); k++) {
+        // Kept labels are no slower than this one; test only the fuel
+        if (labels[k].fuel >= best_fuel) continue;
+        best_fuel = labels[k].fuel;
+        labels[kept++] = labels[k];
+    }
+    labels.resize(kept);
+
+    if (max_labels >= 2 && (int)labels.size() > max_labels) {
+        vector<PathLabel> thinned(max_labels);
+        for (int k = 0; k < max_labels; k++) {
+            thinned[k] = labels[(size_t)k * (labels.size() - 1) / (max_labels - 1)];
+        }
+        labels.swap(thinned);
+    }
+}
+
+vector<ParetoProfile> solve_pareto_front(const Scenario& scenario, SolverWorkspace& workspace,
+                                         int max_labels = PARETO_MAX_LABELS) {
+    scenario.validate();
+    const OptimizationCriterion programs[2] = {MIN_TIME, MIN_FUEL};
+
+    vector<double> H_grid, V_grid;
+    build_grid_axes(scenario, H_grid, V_grid);
+    const SegmentTable* tables[2] = {
+        &workspace.segments.lookup(MIN_TIME, scenario, H_grid),
+        &workspace.segments.lookup(MIN_FUEL, scenario, H_grid)
+    };
+
+    vector<PathLabel> pool;
+    size_t goal_begin = sweep_labels(scenario, H_grid, V_grid, programs, tables, 2,
+                                     [max_labels](vector<PathLabel>& labels) {
+                                         prune_labels(labels, max_labels);
+                                     },
+                                     pool);
+
+    vector<ParetoProfile> front;
+    for (size_t g = goal_begin; g < pool.size(); g++) {
+        ParetoProfile profile;
+        profile.trajectory = trajectory_from_labels(pool, g, scenario, H_grid, V_grid, &profile.programs);
+        front.push_back(profile);
+    }
+    return front;
+}
+
+// ========== CONSOLE REPORT ==========
+void print_trajectory_report(const TrajectoryResult& trajectory, OptimizationCriterion criterion,
+                             ostream& out = cout) {
+    out << "\n========================================\n";
+    if (criterion == MIN_TIME) {
+        out << "OPTIMIZATION CRITERION: MINIMUM TIME\n";
+    } else {
+        out << "OPTIMIZATION CRITERION: MINIMUM FUEL\n";
+    }
+    out << "========================================\n\n";
+
+    if (trajectory.path.empty()) {
+        out << "ERROR: No valid trajectory found!\n";
+        out << "Try increasing thrust settings or using more gradual maneuvers.\n";
+        return;
+    }
+
+    out << "Optimal trajectory:\n";
+    out << "--------------------------------------------------------\n";
+    out << "Point\tAltitude (m)\tVelocity (km/h)\tManeuver\n";
+    out << "--------------------------------------------------------\n";
+
+    for (size_t k = 0; k < trajectory.path.size(); k++) {
+        out << k + 1 << "\t" << fixed << setprecision(0)
+            << setw(8) << trajectory.path[k].first
+            << "\t" << setw(12) << trajectory.path[k].second * 3.6;
+
+        if (k > 0) {
+            switch (trajectory.maneuvers[k]) {
+                case ACCELERATION: out << "\t[Acceleration]"; break;
+                case CLIMB: out << "\t[Climb]"; break;
+                case COMBINED: out << "\t[Combined]"; break;
+            }
+        } else {
+            out << "\t[Start]";
+        }
+        out << "\n";
+    }
+
+    out << "\n=============================================\n";
+    out << "Maneuvers used:\n";
+    out << "- Acceleration: " << trajectory.used_acceleration << " times\n";
+    out << "- Climb: " << trajectory.used_climb << " times\n";
+    out << "- Combined: " << trajectory.used_combined << " times\n";
+    out << "------------------------------------------------\n";
+    out << fixed << setprecision(1);
+    out << "Total time: " << trajectory.total_time << " s ("
+        << trajectory.total_time / 60.0 << " min)\n";
+    out << "Total fuel: " << trajectory.total_fuel << " kg\n";
+    out << "Average climb rate: " << trajectory.avg_climb_rate
+        << " m/s (" << trajectory.avg_climb_rate * 60.0 << " m/min)\n";
+    out << "=============================================\n";
+}
+
+void print_pareto_report(const vector<ParetoProfile>& front, ostream& out = cout) {
+    out << "\n========================================\n";
+    out << "PARETO FRONT: TIME VS FUEL\n";
+    out << "========================================\n\n";
+
+    if (front.empty()) {
+        out << "ERROR: No valid trajectory found!\n";
+        return;
+    }
+
+    out << "Profile\tTime (s)\tFuel (kg)\tPoints\tMin-fuel program share\n";
+    out << "--------------------------------------------------------\n";
+    for (size_t k = 0; k < front.size(); k++) {
+        const ParetoProfile& profile = front[k];
+        int fuel_program = (int)count(profile.programs.begin() + 1, profile.programs.end(), MIN_FUEL);
+        out << k + 1 << "\t" << fixed << setprecision(1)
+            << setw(8) << profile.trajectory.total_time << "\t"
+            << setw(9) << profile.trajectory.total_fuel << "\t"
+            << setw(6) << profile.trajectory.path.size() << "\t"
+            << setprecision(0) << setw(5) << 100.0 * fuel_program / (profile.programs.size() - 1) << "%\n";
+    }
+    out << "--------------------------------------------------------\n";
+}
+
+// ========== LEVEL OF DETAIL ==========
+// A path on a 5000x5000 grid has ~10^4 nodes, a plot is ~10^3 pixels wide.
+// Plots and .dat files keep only the points that change the picture:
+// Ramer-Douglas-Peucker (drops points within a tolerance of the line through
+// their neighbours) or min/max buckets (the extremes of each run of points).
+enum DecimationMethod { DECIMATE_FULL, DECIMATE_RDP, DECIMATE_MINMAX };
+
+struct LevelOfDetail {
+    DecimationMethod method;
+    double tolerance;   // RDP: allowed deviation, share of the path's extent
+    size_t buckets;     // min/max: runs along the path
+    size_t min_points;  // shorter paths are kept whole
+
+    LevelOfDetail() : method(DECIMATE_RDP), tolerance(5e-4), buckets(1000), min_points(2000) {}
+};
+
+// full, rdp[:TOLERANCE] or minmax[:BUCKETS]
+LevelOfDetail parse_level_of_detail(const string& text) {
+    LevelOfDetail lod;
+    size_t colon = text.find(':');
+    string method = text.substr(0, colon);
+    string argument = colon == string::npos ? "" : text.substr(colon + 1);
+    if (method == "full" && argument.empty()) {
+        lod.method = DECIMATE_FULL;
+        return lod;
+    }
+    try {
+        size_t used = argument.size();
+        if (method == "rdp") {
+            lod.method = DECIMATE_RDP;
+            if (!argument.empty()) lod.tolerance = stod(argument, &used);
+            if (used == argument.size() && lod.tolerance > 0) return lod;
+        } else if (method == "minmax") {
+            lod.method = DECIMATE_MINMAX;
+            if (!argument.empty()) lod.buckets = stoul(argument, &used);
+            if (used == argument.size() && lod.buckets > 0) return lod;
+        }
+    } catch (const exception&) {
+    }
+    throw invalid_argument("detail must be full, rdp[:TOLERANCE] or minmax[:BUCKETS], got '" + text + "'");
+}
+
+// Indices of the points to keep, in order; the first and the last are always
+// kept. x(k), y(k) give the coordinates of point k.
+template <class X, class Y>
+void decimate(size_t n, X x, Y y, const LevelOfDetail& lod, vector<size_t>& keep) {
+    keep.clear();
+    if (lod.method == DECIMATE_FULL || n <= max<size_t>(lod.min_points, 2)) {
+        for (size_t k = 0; k < n; k++) keep.push_back(k);
+        return;
+    }
+
+    if (lod.method == DECIMATE_MINMAX) {
+        size_t bucket = (n + lod.buckets - 1) / lod.buckets;
+        for (size_t first = 0; first < n; first += bucket) {
+            size_t last = min(first + bucket, n) - 1;
+            size_t low_x = first, high_x = first, low_y = first, high_y = first;
+            for (size_t k = first + 1; k <= last; k++) {
+                if (x(k) < x(low_x)) low_x = k;
+                if (x(k) > x(high_x)) high_x = k;
+                if (y(k) < y(low_y)) low_y = k;
+                if (y(k) > y(high_y)) high_y = k;
+            }
+            size_t picked[6] = {first, low_x, high_x, low_y, high_y, last};
+            sort(picked, picked + 6);
+            for (size_t p = 0; p < 6; p++) {
+                if (p == 0 || picked[p] != picked[p - 1]) keep.push_back(picked[p]);
+            }
+        }
+        return;
+    }
+
+    // RDP in coordinates scaled to the path's extent, with an explicit stack
+    double x_min = x(0), x_max = x(0), y_min = y(0), y_max = y(0);
+    for (size_t k = 1; k < n; k++) {
+        x_min = min(x_min, x(k));
+        x_max = max(x_max, x(k));
+        y_min = min(y_min, y(k));
+        y_max = max(y_max, y(k));
+    }
+    double sx = x_max > x_min ? 1.0 / (x_max - x_min) : 1.0;
+    double sy = y_max > y_min ? 1.0 / (y_max - y_min) : 1.0;
+    double tolerance2 = lod.tolerance * lod.tolerance;
+
+    vector<unsigned char> kept(n, 0);
+    kept[0] = kept[n - 1] = 1;
+    vector<pair<size_t, size_t>> stack(1, make_pair((size_t)0, n - 1));
+    while (!stack.empty()) {
+        size_t a = stack.back().first, b = stack.back().second;
+        stack.pop_back();
+        if (b - a < 2) continue;
+
+        double ax = x(a) * sx, ay = y(a) * sy;
+        double dx = x(b) * sx - ax, dy = y(b) * sy - ay;
+        double length2 = dx * dx + dy * dy;
+        double worst = -1;
+        size_t worst_k = a;
+        for (size_t k = a + 1; k < b; k++) {
+            double px = x(k) * sx - ax, py = y(k) * sy - ay;
+            // Squared distance to the segment a-b
+            double t = length2 > 0 ? max(0.0, min(1.0, (px * dx + py * dy) / length2)) : 0.0;
+            double ex = px - t * dx, ey = py - t * dy;
+            double distance2 = ex * ex + ey * ey;
+            if (distance2 > worst) {
+                worst = distance2;
+                worst_k = k;
+            }
+        }
+        if (worst <= tolerance2) continue;
+        kept[worst_k] = 1;
+        stack.push_back(make_pair(a, worst_k));
+        stack.push_back(make_pair(worst_k, b));
+    }
+    for (size_t k = 0; k < n; k++) {
+        if (kept[k]) keep.push_back(k);
+    }
+}
+
+// H-V points of a solved path: x = velocity km/h, y = altitude m
+void decimate_path(const TrajectoryResult& traj, const LevelOfDetail& lod, vector<size_t>& keep) {
+    const vector<pair<double, double>>& path = traj.path;
+    decimate(path.size(),
+             [&](size_t k) { return path[k].second * 3.6; },
+             [&](size_t k) { return path[k].first; },
+             lod, keep);
+}
+
+// ========== GNUPLOT PIPE ==========
+// Plots go through the GnuplotPipe of the Seminar 7 tasks: one gnuplot
+// process fed through a pipe, with trajectories inline in gnuplot's binary
+// format, so plots need no data files, no scripts and no extra processes; a
+// batch run sends all its plots through one pipe.
+
+// H-V diagram of several trajectories; the first two are drawn red and blue.
+// Labels and the terminal are left to the caller. Decimated paths are drawn
+// without point markers, which would no longer sit on grid nodes.
+void plot_trajectories(GnuplotPipe& gp, const string& title,
+                       const vector<const TrajectoryResult*>& trajectories,
+                       const vector<string>& names, const LevelOfDetail& lod = LevelOfDetail()) {
+    ostringstream plot;
+    vector<const TrajectoryResult*> drawn;
+    vector<vector<size_t>> kept;
+    for (size_t k = 0; k < trajectories.size(); k++) {
+        if (trajectories[k]->path.empty()) continue;
+        kept.push_back(vector<size_t>());
+        decimate_path(*trajectories[k], lod, kept.back());
+        bool whole = kept.back().size() == trajectories[k]->path.size();
+        plot << (drawn.empty() ? "plot " : ", \\\n     ") << GnuplotPipe::binarySource(kept.back().size(), 2)
+             << " using 1:2 with " << (whole ? "linespoints " : "lines ");
+        if (drawn.size() < 2) plot << "ls " << drawn.size() + 1;
+        else plot << "lt " << drawn.size() + 1 << " lw 2 pt 7 ps 0.5";
+        plot << " title '" << names[k] << "'";
+        drawn.push_back(trajectories[k]);
+    }
+    if (drawn.empty()) return;
+
+    gp.command("set title '" + title + "'\n"
+               "set xlabel 'Velocity (km/h)'\n"
+               "set ylabel 'Altitude (m)'\n"
+               "set grid\n"
+               "set key top left\n"
+               "set style line 1 lc rgb '#FF0000' lw 2 pt 7 ps 0.5\n"
+               "set style line 2 lc rgb '#0000FF' lw 2 pt 7 ps 0.5\n");
+    gp.command(plot.str() + "\n");
+    // (velocity km/h, altitude m) records of the kept points
+    for (size_t k = 0; k < drawn.size(); k++) {
+        const TrajectoryResult& traj = *drawn[k];
+        const vector<size_t>& keep = kept[k];
+        gp.data(keep.size(), [&](size_t p) { return traj.path[keep[p]].second * 3.6; },
+                [&](size_t p) { return traj.path[keep[p]].first; });
+    }
+    gp.flush();
 }
 
 // ========== GNUPLOT VISUALIZATION FUNCTIONS ==========
+// Velocity(km/h) Altitude(m) lines of the points kept by lod
+void write_path_dat(ostream& out, const TrajectoryResult& traj, const LevelOfDetail& lod) {
+    vector<size_t> keep;
+    decimate_path(traj, lod, keep);
+    out << "# Velocity(km/h) Altitude(m)";
+    if (keep.size() < traj.path.size()) out << ", " << keep.size() << " of " << traj.path.size() << " points";
+    out << "\n";
+    for (size_t k : keep) {
+        out << traj.path[k].second * 3.6 << " " << traj.path[k].first << "\n";
+    }
+}
+
 void create_single_plot(const TrajectoryResult& traj, OptimizationCriterion criterion) {
     string filename, plot_title, traj_name;
 
@@ -570,14 +3503,27 @@ void create_single_plot(const TrajectoryResult& traj, OptimizationCriterion crit
         traj_name = "Min Fuel";
     }
 
+    ostringstream labels;
+    labels << "set label 1 at graph 0.05,0.90 sprintf('Time: %.1f s (%.1f min)', "
+           << traj.total_time << ", " << traj.total_time/60.0 << ")\n";
+    labels << "set label 2 at graph 0.05,0.85 sprintf('Fuel: %.1f kg', "
+           << traj.total_fuel << ")\n";
+    labels << "set label 3 at graph 0.05,0.80 sprintf('Climb rate: %.2f m/s', "
+           << traj.avg_climb_rate << ")\n";
+
+    // Straight to gnuplot when it is installed
+    if (gnuplot_available()) {
+        GnuplotPipe gp(true);
+        gp.command("set terminal wxt size 800,600 enhanced\n" + labels.str());
+        plot_trajectories(gp, plot_title, vector<const TrajectoryResult*>(1, &traj),
+                          vector<string>(1, traj_name));
+        cout << "\nPlot sent to gnuplot\n\n";
+        return;
+    }
+
     // Save trajectory data
     ofstream data_file(filename);
-    data_file << "# Velocity(km/h) Altitude(m)\n";
-
-    for (size_t k = 0; k < traj.path.size(); k++) {
-        data_file << traj.path[k].second * 3.6 << " "
-                 << traj.path[k].first << "\n";
-    }
+    write_path_dat(data_file, traj, LevelOfDetail());
     data_file.close();
 
     // Create gnuplot script for single trajectory
@@ -593,13 +3539,7 @@ void create_single_plot(const TrajectoryResult& traj, OptimizationCriterion crit
     gp << "set style line 1 lc rgb '#FF0000' lw 2 pt 7 ps 0.5\n";
 
     // Add statistics to plot
-    gp << "stats '" << filename << "' using 1:2 nooutput\n";
-    gp << "set label 1 at graph 0.05,0.90 sprintf('Time: %.1f s (%.1f min)', "
-       << traj.total_time << ", " << traj.total_time/60.0 << ")\n";
-    gp << "set label 2 at graph 0.05,0.85 sprintf('Fuel: %.1f kg', "
-       << traj.total_fuel << ")\n";
-    gp << "set label 3 at graph 0.05,0.80 sprintf('Climb rate: %.2f m/s', "
-       << traj.avg_climb_rate << ")\n";
+    gp << labels.str();
 
     gp << "# Plot H-V diagram\n";
     gp << "plot '" << filename << "' using 1:2 with linespoints ls 1 title '"
@@ -618,24 +3558,28 @@ void create_single_plot(const TrajectoryResult& traj, OptimizationCriterion crit
 
 void create_comparison_plot(const TrajectoryResult& time_traj,
                            const TrajectoryResult& fuel_traj) {
+    // Straight to gnuplot when it is installed
+    if (gnuplot_available()) {
+        vector<const TrajectoryResult*> trajectories;
+        trajectories.push_back(&time_traj);
+        trajectories.push_back(&fuel_traj);
+        vector<string> names;
+        names.push_back("Min Time");
+        names.push_back("Min Fuel");
+
+        GnuplotPipe gp(true);
+        gp.command("set terminal wxt size 800,600 enhanced\n");
+        plot_trajectories(gp, "Flight Trajectory Comparison H(V) for TU-134", trajectories, names);
+        cout << "\nPlot sent to gnuplot\n\n";
+        return;
+    }
+
     // Save trajectory data
     ofstream time_file("time_trajectory.dat");
     ofstream fuel_file("fuel_trajectory.dat");
 
-    time_file << "# Velocity(km/h) Altitude(m)\n";
-    fuel_file << "# Velocity(km/h) Altitude(m)\n";
-
-    // Save time trajectory data
-    for (size_t k = 0; k < time_traj.path.size(); k++) {
-        time_file << time_traj.path[k].second * 3.6 << " "
-                 << time_traj.path[k].first << "\n";
-    }
-
-    // Save fuel trajectory data
-    for (size_t k = 0; k < fuel_traj.path.size(); k++) {
-        fuel_file << fuel_traj.path[k].second * 3.6 << " "
-                 << fuel_traj.path[k].first << "\n";
-    }
+    write_path_dat(time_file, time_traj, LevelOfDetail());
+    write_path_dat(fuel_file, fuel_traj, LevelOfDetail());
 
     time_file.close();
     fuel_file.close();
@@ -669,36 +3613,1006 @@ void create_comparison_plot(const TrajectoryResult& time_traj,
     cout << "==============================================\n\n";
 }
 
+// ========== BINARY TRAJECTORY FILES ==========
+// HW --paths_binary paths.hwt writes every trajectory of a batch run in a
+// compact binary file; HW --convert paths.hwt out.dat turns it into the text
+// format of the .dat files above for gnuplot. The format, the writer and the
+// memory-mapped reader are in trajectory_file.h.
+
+// Appends one record to buffer; batch workers build their records in parallel
+void append_trajectory_record(string& buffer, uint32_t case_number, const string& label,
+                              const TrajectoryResult& trajectory) {
+    const size_t n = trajectory.path.size();
+    TrajectoryRecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.point_count = n;
+    header.case_number = case_number;
+    strncpy(header.label, label.c_str(), sizeof(header.label) - 1);
+    header.total_time = trajectory.total_time;
+    header.total_fuel = trajectory.total_fuel;
+    header.avg_climb_rate = trajectory.avg_climb_rate;
+
+    size_t offset = buffer.size();
+    buffer.resize(offset + trajectory_record_bytes(n), '\0');
+    char* out = &buffer[offset];
+    memcpy(out, &header, sizeof(header));
+    double* column = reinterpret_cast<double*>(out + sizeof(header));
+    for (size_t k = 0; k < n; k++) {
+        column[k] = trajectory.path[k].first;
+        column[n + k] = trajectory.path[k].second;
+        column[2 * n + k] = trajectory.time_points[k];
+        column[3 * n + k] = trajectory.mass_points[k];
+        column[4 * n + k] = trajectory.fuel_points[k];
+    }
+    unsigned char* maneuver = reinterpret_cast<unsigned char*>(column + 5 * n);
+    for (size_t k = 1; k < n; k++) maneuver[k] = (unsigned char)trajectory.maneuvers[k];
+}
+
+// Text in the layout of the .dat files above, one gnuplot data block per
+// trajectory (plot 'out.dat' index K using 1:2); lod picks the H-V points
+void write_trajectory_dat(const TrajectoryFileReader& reader, ostream& out, const LevelOfDetail& lod) {
+    out << setprecision(numeric_limits<double>::max_digits10);
+    vector<size_t> keep;
+    for (size_t k = 0; k < reader.count(); k++) {
+        const TrajectoryView& view = reader[k];
+        decimate(view.size(),
+                 [&](size_t p) { return view.velocity[p] * 3.6; },
+                 [&](size_t p) { return view.altitude[p]; },
+                 lod, keep);
+        if (k > 0) out << "\n\n";
+        out << "# case " << view.header->case_number << ", " << view.label()
+            << ": time " << view.header->total_time << " s, fuel " << view.header->total_fuel << " kg";
+        if (keep.size() < view.size()) out << ", " << keep.size() << " of " << view.size() << " points";
+        out << "\n# Velocity(km/h) Altitude(m) Time(s) Mass(kg) Fuel(kg) Maneuver\n";
+        for (size_t p : keep) {
+            out << view.velocity[p] * 3.6 << " " << view.altitude[p] << " " << view.time[p] << " "
+                << view.mass[p] << " " << view.fuel[p] << " " << (int)view.maneuver[p] << "\n";
+        }
+    }
+}
+
+// HW --convert IN.hwt [OUT.dat] [--detail D]
+int run_convert(int argc, char* argv[]) {
+    vector<string> files;
+    LevelOfDetail lod;
+    for (int k = 2; k < argc; k++) {
+        string arg = argv[k];
+        if (arg == "--detail" && k + 1 < argc) lod = parse_level_of_detail(argv[++k]);
+        else files.push_back(arg);
+    }
+    if (files.empty() || files.size() > 2) {
+        cerr << "Usage: HW --convert FILE.hwt [OUT.dat] [--detail D]   (default OUT: stdout)\n"
+             << "  --detail D   rdp[:TOLERANCE] (default rdp:0.0005, share of the path's extent),\n"
+             << "               minmax[:BUCKETS] or full (every point)\n";
+        return 2;
+    }
+    TrajectoryFileReader reader(files[0]);
+    string output_file = files.size() > 1 ? files[1] : "-";
+    if (output_file == "-") {
+        write_trajectory_dat(reader, cout, lod);
+        return 0;
+    }
+    ofstream out(output_file.c_str());
+    if (!out) throw runtime_error("cannot open output file " + output_file);
+    write_trajectory_dat(reader, out, lod);
+    return 0;
+}
+
+// ========== BATCH MODE ==========
+// Non-interactive runs: HW --scenario cases.csv --output results.csv
+// Sweeps: HW --mass 40000:52000:13 --thrust 0.8:1:5 --output envelope.csv
+struct BatchCase {
+    string name;
+    Scenario scenario;
+};
+
+// Values of one swept scenario field
+struct SweepAxis {
+    string key;
+    vector<double> values;
+};
+
+struct BatchOptions {
+    Scenario base;
+    vector<SweepAxis> sweep;
+    vector<pair<double, double>> targets; // (altitude m, velocity m/s)
+    string scenario_file;
+    string output_file;
+    string paths_file;
+    string paths_binary_file;
+    string cost_to_go_prefix;
+    string plots_prefix;
+    string plot_format;
+    string reference_prefix;
+    double reference_rate;
+    LevelOfDetail plot_detail;
+    bool solve_time;
+    bool solve_fuel;
+    bool solve_pareto;
+    unsigned threads;
+    unsigned jobs;
+
+    BatchOptions() : output_file("-"), plot_format("png"), reference_rate(REFERENCE_RATE), solve_time(true),
+                     solve_fuel(true), solve_pareto(false), threads(0), jobs(0) {}
+};
+
+void print_batch_usage(ostream& out) {
+    out << "Usage: HW [NH [NV]]            interactive mode\n"
+        << "       HW [options]            batch mode\n"
+        << "       HW --bench [options]    solver benchmark (HW --bench --help)\n"
+        << "       HW --convert F [OUT]    binary trajectory file to gnuplot text\n"
+        << "                               (--detail full keeps every point)\n\n"
+        << "Options:\n"
+        << "  --scenario FILE     CSV of cases: name,h0,h1,v0,v1,mass,thrust,nh,nv,\n"
+        << "                      mass_step,refine,search,jump,aircraft,controls\n"
+        << "                      (header required, missing columns use the values below)\n"
+        << "  --criterion C       time, fuel, both (default), pareto (time-fuel front:\n"
+        << "                      rows pareto1..N from fastest) or all\n"
+        << "  --nh N, --nv N      grid steps in altitude / velocity\n"
+        << "  --mass_step KG      track the mass per node in buckets of KG burnt fuel\n"
+        << "                      (0 = one mass per node, the default)\n"
+        << "  --refine R          coarse-to-fine solve: corridors refined R times per level\n"
+        << "                      (0 = full grid, the default)\n"
+        << "  --search S          sweep (every cell, the default) or astar (best-first\n"
+        << "                      from the start with a lower bound of the cost to go)\n"
+        << "  --jump K            combined moves of up to K steps in H and V (default 1)\n"
+        << "  --controls C        fixed (scheduled angle of attack and throttle, the\n"
+        << "                      default) or optimal (searched per edge)\n"
+        << "  --h0 M, --h1 M      initial / final altitude, m\n"
+        << "  --v0 K, --v1 K      initial / final velocity, km/h\n"
+        << "  --aircraft A        tu134 (default), tu154, yak42 or a type from --aircraft_file\n"
+        << "  --aircraft_file F   load aircraft types (name=..., then key=value lines);\n"
+        << "                      may be repeated\n"
+        << "  --mass KG           takeoff mass, kg (0 = the aircraft's default)\n"
+        << "  --thrust F          available share of nominal thrust (1 = 100%)\n"
+        << "                      h0, h1, v0, v1, mass and thrust also take a sweep:\n"
+        << "                      FROM:TO:COUNT (evenly spaced) or A,B,C (list);\n"
+        << "                      every combination becomes one case\n"
+        << "  --targets LIST      H:V,H:V,... final altitudes (m) and velocities (km/h):\n"
+        << "                      every case is swept once per criterion and each target\n"
+        << "                      is a backtrack on its grid, extended when needed\n"
+        << "  --jobs N            cases solved at once (0 = all hardware threads)\n"
+        << "  --threads N         threads per solve (0 = all, or 1 when jobs > 1)\n"
+        << "                      (never more than the hardware threads)\n"
+        << "  --output FILE       results CSV (default '-' = stdout)\n"
+        << "  --paths FILE        also write every trajectory point to FILE\n"
+        << "  --paths_binary FILE the same in the binary format (HW --convert reads it)\n"
+        << "  --cost_to_go P      also write the cost-to-go table of every case and\n"
+        << "                      criterion to P_<case>_<criterion>.ctg (plain grid\n"
+        << "                      cases only)\n"
+        << "  --plots P           plot the trajectories of every case to P_<case>.png\n"
+        << "                      (one gnuplot process for the whole run)\n"
+        << "  --plot_format F     png (default) or svg\n"
+        << "  --plot_detail D     points of long paths kept in plots: rdp[:TOL] (default,\n"
+        << "                      tolerance 0.0005 of the path's extent), minmax[:BUCKETS]\n"
+        << "                      or full; paths under 2000 points are always whole\n"
+        << "  --reference P       also write the time and fuel solutions sampled at a fixed\n"
+        << "                      rate (H, V, theta, throttle, alpha) to P_<case>_<criterion>.csv\n"
+        << "  --reference_rate HZ samples per second of --reference (default 50)\n"
+        << "  --help              show this message\n";
+}
+
+double parse_double(const string& key, const string& value) {
+    size_t used = 0;
+    double result = 0;
+    try {
+        result = stod(value, &used);
+    } catch (const exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != value.size()) {
+        throw invalid_argument("bad number '" + value + "' for " + key);
+    }
+    return result;
+}
+
+int parse_int(const string& key, const string& value) {
+    size_t used = 0;
+    int result = 0;
+    try {
+        result = stoi(value, &used);
+    } catch (const exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != value.size()) {
+        throw invalid_argument("bad integer '" + value + "' for " + key);
+    }
+    return result;
+}
+
+// Real-valued fields, in sweep nesting order (outermost first): cases that share
+// altitudes and thrust are adjacent and reuse the cached segment rows
+const char* const SWEEP_FIELDS[] = {"h0", "h1", "thrust", "v0", "v1", "mass"};
+
+bool is_sweep_field(const string& key) {
+    return find(begin(SWEEP_FIELDS), end(SWEEP_FIELDS), key) != end(SWEEP_FIELDS);
+}
+
+// Velocities are in km/h
+void set_scenario_value(Scenario& scenario, const string& key, double value) {
+    if (key == "h0") scenario.initial_altitude = value;
+    else if (key == "h1") scenario.final_altitude = value;
+    else if (key == "v0") scenario.initial_velocity = value / 3.6;
+    else if (key == "v1") scenario.final_velocity = value / 3.6;
+    else if (key == "mass") scenario.takeoff_mass = value;
+    else if (key == "thrust") scenario.thrust_fraction = value;
+    else if (key == "mass_step") scenario.mass_step = value;
+    else throw invalid_argument("unknown scenario field '" + key + "'");
+}
+
+// Shared by the command line (--key) and scenario file columns
+void apply_scenario_field(Scenario& scenario, const string& key, const string& value) {
+    if (key == "nh") scenario.NH = parse_int(key, value);
+    else if (key == "nv") scenario.NV = parse_int(key, value);
+    else if (key == "refine") scenario.refine = parse_int(key, value);
+    else if (key == "jump") scenario.jump = parse_int(key, value);
+    else if (key == "aircraft") scenario.aircraft = parse_aircraft(value);
+    else if (key == "controls") {
+        if (value != "fixed" && value != "optimal") {
+            throw invalid_argument("controls must be fixed or optimal");
+        }
+        scenario.optimal_controls = value == "optimal";
+    }
+    else if (key == "search") {
+        if (value != "sweep" && value != "astar") {
+            throw invalid_argument("search must be sweep or astar");
+        }
+        scenario.best_first = value == "astar";
+    }
+    else set_scenario_value(scenario, key, parse_double(key, value));
+}
+
+// FROM:TO:COUNT or A,B,C
+vector<double> parse_sweep(const string& key, const string& value) {
+    vector<double> values;
+    if (value.find(':') != string::npos) {
+        size_t first = value.find(':');
+        size_t second = value.find(':', first + 1);
+        if (second == string::npos) {
+            throw invalid_argument("sweep for " + key + " must be FROM:TO:COUNT");
+        }
+        double from = parse_double(key, value.substr(0, first));
+        double to = parse_double(key, value.substr(first + 1, second - first - 1));
+        int count = parse_int(key, value.substr(second + 1));
+        if (count < 1) throw invalid_argument("sweep count for " + key + " must be positive");
+        for (int k = 0; k < count; k++) {
+            values.push_back(count == 1 ? from : from + (to - from) * k / (count - 1));
+        }
+    } else {
+        size_t start = 0;
+        while (true) {
+            size_t comma = value.find(',', start);
+            values.push_back(parse_double(key, value.substr(start, comma - start)));
+            if (comma == string::npos) break;
+            start = comma + 1;
+        }
+    }
+    return values;
+}
+
+// Every combination of the sweep axes applied to the base scenario
+vector<BatchCase> expand_sweep(const Scenario& base, const vector<SweepAxis>& sweep) {
+    vector<BatchCase> cases;
+    vector<size_t> position(sweep.size(), 0);
+    while (true) {
+        BatchCase bc;
+        bc.name = sweep.empty() ? "default" : "sweep";
+        bc.scenario = base;
+        for (size_t a = 0; a < sweep.size(); a++) {
+            set_scenario_value(bc.scenario, sweep[a].key, sweep[a].values[position[a]]);
+        }
+        cases.push_back(bc);
+
+        // Odometer step, last axis fastest
+        size_t a = sweep.size();
+        while (a > 0 && ++position[a - 1] == sweep[a - 1].values.size()) {
+            position[a - 1] = 0;
+            a--;
+        }
+        if (a == 0) break;
+    }
+    return cases;
+}
+
+const char* const SCENARIO_COLUMNS[] = {"name", "h0", "h1", "v0", "v1", "mass", "thrust", "nh", "nv",
+                                        "mass_step", "refine", "search", "jump", "aircraft",
+                                        "controls"};
+
+vector<string> split_csv_line(const string& line) {
+    vector<string> fields;
+    string field;
+    for (char c : line) {
+        if (c == ',') {
+            fields.push_back(field);
+            field.clear();
+        } else if (c != ' ' && c != '\t' && c != '\r') {
+            field += c;
+        }
+    }
+    fields.push_back(field);
+    return fields;
+}
+
+vector<BatchCase> load_scenario_file(const string& path, const Scenario& base) {
+    ifstream in(path);
+    if (!in) throw runtime_error("cannot open scenario file " + path);
+
+    vector<string> columns;
+    vector<BatchCase> cases;
+    string line;
+    int line_no = 0;
+
+    while (getline(in, line)) {
+        line_no++;
+        if (line.find_first_not_of(" \t\r") == string::npos) continue;
+        if (line[line.find_first_not_of(" \t")] == '#') continue;
+
+        vector<string> fields = split_csv_line(line);
+        if (columns.empty()) {
+            columns = fields;
+            for (const string& key : columns) {
+                if (find(begin(SCENARIO_COLUMNS), end(SCENARIO_COLUMNS), key) == end(SCENARIO_COLUMNS)) {
+                    throw runtime_error(path + ": unknown column '" + key + "'");
+                }
+            }
+            continue;
+        }
+
+        if (fields.size() != columns.size()) {
+            throw runtime_error(path + ":" + to_string(line_no) + ": expected "
+                                + to_string(columns.size()) + " fields");
+        }
+
+        BatchCase bc;
+        bc.scenario = base;
+        bc.name = "case" + to_string(cases.size() + 1);
+        try {
+            for (size_t c = 0; c < columns.size(); c++) {
+                if (columns[c] == "name") {
+                    if (!fields[c].empty()) bc.name = fields[c];
+                } else if (!fields[c].empty()) {
+                    apply_scenario_field(bc.scenario, columns[c], fields[c]);
+                }
+            }
+        } catch (const invalid_argument& e) {
+            throw runtime_error(path + ":" + to_string(line_no) + ": " + e.what());
+        }
+        cases.push_back(bc);
+    }
+
+    if (columns.empty()) throw runtime_error("scenario file " + path + " has no header");
+    return cases;
+}
+
+BatchOptions parse_batch_options(int argc, char* argv[]) {
+    BatchOptions options;
+
+    // Aircraft types first, so --aircraft and scenario files can name them
+    for (int k = 1; k + 1 < argc; k++) {
+        if (string(argv[k]) == "--aircraft_file") aircraft_registry().loadFromFile(argv[++k]);
+    }
+
+    for (int k = 1; k < argc; k++) {
+        string arg = argv[k];
+        if (arg == "--help" || arg == "-h") {
+            print_batch_usage(cout);
+            exit(0);
+        }
+        if (arg.compare(0, 2, "--") != 0 || k + 1 >= argc) {
+            throw invalid_argument("bad option '" + arg + "' (see --help)");
+        }
+        string key = arg.substr(2);
+        string value = argv[++k];
+
+        if (key == "aircraft_file") continue;
+        else if (key == "scenario") options.scenario_file = value;
+        else if (key == "output") options.output_file = value;
+        else if (key == "paths") options.paths_file = value;
+        else if (key == "paths_binary") options.paths_binary_file = value;
+        else if (key == "cost_to_go") options.cost_to_go_prefix = value;
+        else if (key == "plots") options.plots_prefix = value;
+        else if (key == "plot_format") {
+            if (value != "png" && value != "svg") throw invalid_argument("plot_format must be png or svg");
+            options.plot_format = value;
+        }
+        else if (key == "plot_detail") options.plot_detail = parse_level_of_detail(value);
+        else if (key == "reference") options.reference_prefix = value;
+        else if (key == "reference_rate") {
+            options.reference_rate = parse_double(key, value);
+            if (!(options.reference_rate > 0)) throw invalid_argument("reference_rate must be positive");
+        }
+        else if (key == "threads" || key == "jobs") {
+            int count = parse_int(key, value);
+            if (count < 0) throw invalid_argument(key + " must not be negative");
+            (key == "threads" ? options.threads : options.jobs) = (unsigned)count;
+        }
+        else if (key == "targets") {
+            options.targets.clear();
+            size_t start = 0;
+            while (true) {
+                size_t comma = value.find(',', start);
+                string item = value.substr(start, comma - start);
+                size_t colon = item.find(':');
+                if (colon == string::npos) throw invalid_argument("targets must be H:V,H:V,...");
+                options.targets.push_back(make_pair(parse_double(key, item.substr(0, colon)),
+                                                    parse_double(key, item.substr(colon + 1)) / 3.6));
+                if (comma == string::npos) break;
+                start = comma + 1;
+            }
+        }
+        else if (key == "criterion") {
+            if (value != "time" && value != "fuel" && value != "both" && value != "pareto" && value != "all") {
+                throw invalid_argument("criterion must be time, fuel, both, pareto or all");
+            }
+            options.solve_time = value == "time" || value == "both" || value == "all";
+            options.solve_fuel = value == "fuel" || value == "both" || value == "all";
+            options.solve_pareto = value == "pareto" || value == "all";
+        }
+        else if (is_sweep_field(key) && value.find_first_of(":,") != string::npos) {
+            SweepAxis axis;
+            axis.key = key;
+            axis.values = parse_sweep(key, value);
+            options.sweep.push_back(axis);
+        }
+        else if (find(begin(SCENARIO_COLUMNS) + 1, end(SCENARIO_COLUMNS), key) != end(SCENARIO_COLUMNS)) {
+            apply_scenario_field(options.base, key, value);
+        }
+        else throw invalid_argument("unknown option '" + arg + "' (see --help)");
+    }
+
+    // Nest the axes in SWEEP_FIELDS order; a repeated option replaces the earlier one
+    vector<SweepAxis> ordered;
+    for (const char* field : SWEEP_FIELDS) {
+        for (size_t a = options.sweep.size(); a-- > 0; ) {
+            if (options.sweep[a].key == field) {
+                ordered.push_back(options.sweep[a]);
+                break;
+            }
+        }
+    }
+    options.sweep = ordered;
+
+    if (!options.sweep.empty() && !options.scenario_file.empty()) {
+        throw invalid_argument("use either a scenario file or sweep ranges, not both");
+    }
+    if (!options.reference_prefix.empty() && !options.targets.empty()) {
+        throw invalid_argument("reference needs the final state of the case, not targets");
+    }
+    return options;
+}
+
+// Formatted rows of one case; filled by the worker that solved it
+struct CaseOutput {
+    string results;
+    string paths;
+    string binary_paths;   // records for the binary trajectory file
+    size_t binary_records;
+    vector<pair<string, TrajectoryResult>> plotted;  // (criterion, trajectory) for --plots
+    string error;
+    bool done;
+
+    CaseOutput() : binary_records(0), done(false) {}
+};
+
+void solve_batch_case(const BatchCase& bc, size_t number, const vector<OptimizationCriterion>& criteria,
+                      const vector<pair<double, double>>& targets, const string& cost_to_go,
+                      const string& reference, double reference_rate, bool pareto, bool with_paths, bool with_binary_paths, bool with_plots, unsigned threads,
+                      SolverWorkspace& workspace, CaseOutput& output) {
+    const Scenario& scenario = bc.scenario;
+    ostringstream out, paths;
+    paths << setprecision(numeric_limits<double>::max_digits10);
+
+    try {
+        scenario.validate();
+    } catch (const invalid_argument& e) {
+        // Logged by the writer so messages keep case order
+        output.error = "case " + to_string(number) + " (" + bc.name + "): " + e.what() + "\n";
+    }
+    if (output.error.empty() && !targets.empty() && !scenario.plainGrid()) {
+        output.error = "case " + to_string(number) + " (" + bc.name + "): targets need the plain grid sweep\n";
+    }
+    if (output.error.empty() && !cost_to_go.empty() && !scenario.plainGrid()) {
+        output.error = "case " + to_string(number) + " (" + bc.name + "): cost-to-go needs the plain grid sweep\n";
+    }
+
+    // shown: the scenario printed in the row
+    auto write = [&](const string& criterion_name, const string& status,
+                     const TrajectoryResult& trajectory, const Scenario& shown) {
+        // Inputs at readable precision, results round-trip exact
+        out << setprecision(10) << number << "," << bc.name << "," << criterion_name << "," << status << ","
+            << shown.initial_altitude << "," << shown.final_altitude << ","
+            << shown.initial_velocity * 3.6 << "," << shown.final_velocity * 3.6 << ","
+            << shown.takeoffMass() << "," << shown.thrust_fraction << ","
+            << shown.NH << "," << shown.NV << "," << shown.mass_step << ","
+            << shown.refine << "," << (shown.best_first ? "astar" : "sweep") << ","
+            << shown.jump << "," << aircraft_name(shown.aircraft) << ","
+            << (shown.optimal_controls ? "optimal" : "fixed") << ",";
+        if (status == "ok") {
+            out << setprecision(numeric_limits<double>::max_digits10) << trajectory.total_time << ","
+                << trajectory.total_fuel << "," << trajectory.avg_climb_rate << ","
+                << trajectory.path.size() << "," << trajectory.used_acceleration << ","
+                << trajectory.used_climb << "," << trajectory.used_combined << "\n";
+        } else {
+            out << ",,,,,,\n";
+        }
+
+        if (with_plots && !trajectory.path.empty()) {
+            output.plotted.push_back(make_pair(criterion_name, trajectory));
+        }
+        if (with_binary_paths && !trajectory.path.empty()) {
+            append_trajectory_record(output.binary_paths, (uint32_t)number, criterion_name, trajectory);
+            output.binary_records++;
+        }
+        if (!with_paths) return;
+        for (size_t k = 0; k < trajectory.path.size(); k++) {
+            const char* maneuver = "start";
+            if (k > 0) {
+                switch (trajectory.maneuvers[k]) {
+                    case ACCELERATION: maneuver = "acceleration"; break;
+                    case CLIMB: maneuver = "climb"; break;
+                    case COMBINED: maneuver = "combined"; break;
+                }
+            }
+            paths << number << "," << criterion_name << "," << k + 1 << ","
+                  << trajectory.path[k].first << "," << trajectory.path[k].second * 3.6 << ","
+                  << trajectory.time_points[k] << "," << trajectory.mass_points[k] << ","
+                  << trajectory.fuel_points[k] << "," << maneuver << "\n";
+        }
+    };
+
+    string target_errors;  // reported once, after the rows of every criterion
+    ReferenceTrajectory reference_samples;
+    for (OptimizationCriterion criterion : criteria) {
+        const char* criterion_name = criterion == MIN_TIME ? "time" : "fuel";
+        if (!output.error.empty()) {
+            write(criterion_name, "invalid", TrajectoryResult(), scenario);
+            continue;
+        }
+        if (!cost_to_go.empty()) {
+            CostToGoTable(criterion, scenario).save(cost_to_go + "_" + to_string(number) + "_"
+                                                    + criterion_name + ".ctg");
+        }
+        if (targets.empty()) {
+            TrajectoryResult trajectory = solve_trajectory_grid(criterion, scenario, workspace, threads);
+            write(criterion_name, trajectory.path.empty() ? "no_path" : "ok", trajectory, scenario);
+            if (!reference.empty() && !trajectory.path.empty()) {
+                resample_trajectory(trajectory, criterion, scenario, reference_samples, reference_rate);
+                string file = reference + "_" + to_string(number) + "_" + criterion_name + ".csv";
+                ofstream reference_file(file.c_str());
+                if (!reference_file) throw runtime_error("cannot open reference file " + file);
+                write_reference_csv(reference_file, reference_samples);
+            }
+            continue;
+        }
+
+        // One sweep per criterion; each target is a backtrack on the same grid
+        PersistentSolver solver(criterion, scenario);
+        for (const pair<double, double>& target : targets) {
+            try {
+                Scenario shown = solver.targetScenario(target.first, target.second);
+                TrajectoryResult trajectory = solver.query(target.first, target.second);
+                write(criterion_name, trajectory.path.empty() ? "no_path" : "ok", trajectory, shown);
+            } catch (const invalid_argument& e) {
+                Scenario shown = scenario;
+                shown.final_altitude = target.first;
+                shown.final_velocity = target.second;
+                write(criterion_name, "invalid", TrajectoryResult(), shown);
+                if (criterion == criteria.front()) {
+                    target_errors += "case " + to_string(number) + " (" + bc.name + "): " + e.what() + "\n";
+                }
+            }
+        }
+    }
+
+    // One row per profile of the front: pareto1 is the fastest
+    if (pareto) {
+        vector<ParetoProfile> front;
+        if (output.error.empty()) front = solve_pareto_front(scenario, workspace);
+        if (front.empty()) {
+            write("pareto", output.error.empty() ? "no_path" : "invalid", TrajectoryResult(), scenario);
+        }
+        for (size_t k = 0; k < front.size(); k++) {
+            write("pareto" + to_string(k + 1), "ok", front[k].trajectory, scenario);
+        }
+    }
+    output.error += target_errors;
+
+    output.results = out.str();
+    output.paths = paths.str();
+}
+
+int run_batch(int argc, char* argv[]) {
+    BatchOptions options = parse_batch_options(argc, argv);
+
+    vector<BatchCase> cases;
+    if (options.scenario_file.empty()) {
+        cases = expand_sweep(options.base, options.sweep);
+    } else {
+        cases = load_scenario_file(options.scenario_file, options.base);
+    }
+
+    ofstream output_stream;
+    if (options.output_file != "-") {
+        output_stream.open(options.output_file);
+        if (!output_stream) throw runtime_error("cannot open output file " + options.output_file);
+    }
+    ostream& out = options.output_file == "-" ? cout : output_stream;
+
+    ofstream paths;
+    if (!options.paths_file.empty()) {
+        paths.open(options.paths_file);
+        if (!paths) throw runtime_error("cannot open paths file " + options.paths_file);
+        paths << "case,criterion,point,altitude_m,velocity_kmh,time_s,mass_kg,fuel_kg,maneuver\n";
+    }
+    TrajectoryFileWriter binary_paths;
+    if (!options.paths_binary_file.empty()) binary_paths.open(options.paths_binary_file);
+    unique_ptr<GnuplotPipe> plots;
+    if (!options.plots_prefix.empty()) {
+        if (!gnuplot_available()) throw runtime_error("--plots needs gnuplot on the PATH");
+        plots.reset(new GnuplotPipe());
+    }
+
+    out << "case,name,criterion,status,h0_m,h1_m,v0_kmh,v1_kmh,mass_kg,thrust,nh,nv,mass_step_kg,refine,search,jump,aircraft,controls,"
+           "total_time_s,total_fuel_kg,avg_climb_rate_ms,points,acceleration,climb,combined\n";
+
+    vector<OptimizationCriterion> criteria;
+    if (options.solve_time) criteria.push_back(MIN_TIME);
+    if (options.solve_fuel) criteria.push_back(MIN_FUEL);
+
+    unsigned jobs = options.jobs > 0 ? options.jobs : max(1u, thread::hardware_concurrency());
+    jobs = (unsigned)min<size_t>(jobs, cases.size());
+    unsigned solve_threads = options.threads == 0 && jobs > 1 ? 1 : options.threads;
+
+    // Workers take cases in order; whoever finishes the oldest pending case
+    // streams every completed case after it, so output order is the case order
+    vector<CaseOutput> outputs(cases.size());
+    atomic<size_t> next_case(0);
+    mutex write_mutex;
+    size_t next_write = 0;
+    int invalid_cases = 0;
+    exception_ptr failure;
+
+    auto worker = [&]() {
+        try {
+            SolverWorkspace workspace;
+            for (size_t c = next_case++; c < cases.size(); c = next_case++) {
+                solve_batch_case(cases[c], c + 1, criteria, options.targets, options.cost_to_go_prefix,
+                                 options.reference_prefix, options.reference_rate,
+                                 options.solve_pareto, paths.is_open(), binary_paths.is_open(),
+                                 plots != nullptr, solve_threads, workspace, outputs[c]);
+
+                lock_guard<mutex> lock(write_mutex);
+                outputs[c].done = true;
+                while (next_write < outputs.size() && outputs[next_write].done) {
+                    CaseOutput& ready = outputs[next_write++];
+                    out << ready.results;
+                    if (!ready.plotted.empty()) {
+                        const BatchCase& bc = cases[next_write - 1];
+                        vector<const TrajectoryResult*> trajectories;
+                        vector<string> names;
+                        for (const pair<string, TrajectoryResult>& p : ready.plotted) {
+                            trajectories.push_back(&p.second);
+                            names.push_back(p.first);
+                        }
+                        plots->output(options.plots_prefix + "_" + to_string(next_write) + "." + options.plot_format,
+                                      800, 600, true);
+                        plots->command("reset\n");
+                        plot_trajectories(*plots, "Case " + to_string(next_write) + " (" + bc.name + ")",
+                                          trajectories, names, options.plot_detail);
+                        plots->command("unset output\n");
+                        vector<pair<string, TrajectoryResult>>().swap(ready.plotted);
+                    }
+                    if (paths.is_open()) paths << ready.paths;
+                    if (binary_paths.is_open()) binary_paths.append(ready.binary_paths, ready.binary_records);
+                    if (!ready.error.empty()) {
+                        cerr << ready.error;
+                        invalid_cases++;
+                    }
+                    string().swap(ready.results);
+                    string().swap(ready.paths);
+                    string().swap(ready.binary_paths);
+                }
+            }
+        } catch (...) {
+            lock_guard<mutex> lock(write_mutex);
+            if (!failure) failure = current_exception();
+            next_case = cases.size();
+        }
+        PROFILE_FLUSH();
+    };
+
+    if (jobs <= 1) {
+        worker();
+    } else {
+        vector<thread> pool;
+        for (unsigned t = 0; t < jobs; t++) pool.emplace_back(worker);
+        for (thread& th : pool) th.join();
+    }
+    if (failure) rethrow_exception(failure);
+    if (binary_paths.is_open()) binary_paths.close();
+#ifdef HW_PROFILE
+    print_profile_counters(profile_take(), cerr);
+#endif
+
+    return invalid_cases > 0 ? 1 : 0;
+}
+
+// ========== BENCHMARK MODE ==========
+// HW --bench --sizes 100,300,1000 --threads 1,2,4 --repeat 5 --output bench.json
+// Times solve_trajectory_grid on square grids for both criteria and every
+// thread count and writes one JSON record per run. The inputs are fixed, so
+// runs on the same machine are comparable; the solution cost is recorded too,
+// so a speed-up that changes results shows up in the same file.
+struct BenchOptions {
+    Scenario base;
+    vector<int> sizes;
+    vector<unsigned> threads;
+    int repeat;
+    string output_file;
+
+    BenchOptions() : repeat(5), output_file("-") {
+        sizes = {100, 300, 1000};
+        unsigned hardware = max(1u, thread::hardware_concurrency());
+        for (unsigned t = 1; t < hardware; t *= 2) threads.push_back(t);
+        threads.push_back(hardware);
+    }
+};
+
+void print_bench_usage(ostream& out) {
+    out << "Usage: HW --bench [options]\n\n"
+        << "Options:\n"
+        << "  --sizes LIST        grid steps per axis, A,B,C or FROM:TO:COUNT (default 100,300,1000)\n"
+        << "  --threads LIST      threads per solve (default 1, 2, 4, ... up to all); 1 is\n"
+        << "                      always run, as the reference of the speed-up\n"
+        << "  --repeat N          timed solves per run after one warm-up (default 5)\n"
+        << "  --output FILE       JSON report (default '-' = stdout)\n"
+        << "  --aircraft_file, --aircraft, --mass_step, --refine, --search, --jump and the\n"
+        << "  boundary conditions of batch mode select the solved scenario\n";
+}
+
+BenchOptions parse_bench_options(int argc, char* argv[]) {
+    BenchOptions options;
+    for (int k = 2; k + 1 < argc; k++) {
+        if (string(argv[k]) == "--aircraft_file") aircraft_registry().loadFromFile(argv[++k]);
+    }
+
+    for (int k = 2; k < argc; k++) {
+        string arg = argv[k];
+        if (arg == "--help" || arg == "-h") {
+            print_bench_usage(cout);
+            exit(0);
+        }
+        if (arg.compare(0, 2, "--") != 0 || k + 1 >= argc) {
+            throw invalid_argument("bad option '" + arg + "' (see --bench --help)");
+        }
+        string key = arg.substr(2);
+        string value = argv[++k];
+
+        if (key == "aircraft_file") continue;
+        else if (key == "output") options.output_file = value;
+        else if (key == "repeat") options.repeat = parse_int(key, value);
+        else if (key == "sizes" || key == "threads") {
+            vector<int> list;
+            for (double v : parse_sweep(key, value)) {
+                if (!(v >= 1) || v != floor(v)) throw invalid_argument(key + " must be positive integers");
+                list.push_back((int)v);
+            }
+            if (key == "sizes") options.sizes = list;
+            else options.threads.assign(list.begin(), list.end());
+        }
+        else if (key != "nh" && key != "nv" &&
+                 find(begin(SCENARIO_COLUMNS) + 1, end(SCENARIO_COLUMNS), key) != end(SCENARIO_COLUMNS)) {
+            apply_scenario_field(options.base, key, value);
+        }
+        else throw invalid_argument("unknown option '" + arg + "' (see --bench --help)");
+    }
+    if (options.repeat < 1) throw invalid_argument("repeat must be positive");
+
+    // Ascending, so the process peak RSS grows with the sizes as far as it can
+    sort(options.sizes.begin(), options.sizes.end());
+    options.sizes.erase(unique(options.sizes.begin(), options.sizes.end()), options.sizes.end());
+    // One thread first: the speed-up of every other count is against it
+    options.threads.push_back(1);
+    sort(options.threads.begin(), options.threads.end());
+    options.threads.erase(unique(options.threads.begin(), options.threads.end()), options.threads.end());
+    return options;
+}
+
+// Peak resident set size of the process so far, KiB. A high-water mark: it
+// never drops, so a run after a larger one still reports the larger peak.
+long long peak_rss_kb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return -1;
+    return (long long)(counters.PeakWorkingSetSize / 1024);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+string compiler_name() {
+#if defined(__clang__)
+    return string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+    return string("gcc ") + __VERSION__;
+#elif defined(_MSC_VER)
+    return "msvc " + to_string(_MSC_VER);
+#else
+    return "unknown";
+#endif
+}
+
+string json_string(const string& text) {
+    string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+int run_bench(int argc, char* argv[]) {
+    BenchOptions options = parse_bench_options(argc, argv);
+
+    ofstream output_stream;
+    if (options.output_file != "-") {
+        output_stream.open(options.output_file);
+        if (!output_stream) throw runtime_error("cannot open output file " + options.output_file);
+    }
+    ostream& out = options.output_file == "-" ? cout : output_stream;
+
+    const Scenario& base = options.base;
+    out << setprecision(6);
+    out << "{\n"
+        << "  \"benchmark\": \"solve_trajectory_grid\",\n"
+        << "  \"compiler\": " << json_string(compiler_name()) << ",\n"
+        << "  \"hardware_threads\": " << thread::hardware_concurrency() << ",\n"
+        << "  \"repeat\": " << options.repeat << ",\n"
+        << "  \"scenario\": {\"aircraft\": " << json_string(aircraft_name(base.aircraft)) << ", "
+        << "\"mass_kg\": " << base.takeoffMass() << ", \"thrust\": " << base.thrust_fraction << ", "
+        << "\"mass_step_kg\": " << base.mass_step << ", \"refine\": " << base.refine << ", "
+        << "\"search\": \"" << (base.best_first ? "astar" : "sweep") << "\", "
+        << "\"jump\": " << base.jump << ", "
+        << "\"controls\": \"" << (base.optimal_controls ? "optimal" : "fixed") << "\"},\n"
+        << "  \"runs\": [";
+
+    const OptimizationCriterion criteria[] = {MIN_TIME, MIN_FUEL};
+    bool first_run = true;
+    for (int size : options.sizes) {
+        Scenario scenario = base;
+        scenario.NH = scenario.NV = size;
+        scenario.validate();
+
+        long long NH = scenario.NH, NV = scenario.NV;
+
+        for (OptimizationCriterion criterion : criteria) {
+            double single_thread_ms = 0;
+            for (unsigned threads : options.threads) {
+                // Warm-up builds the segment table and allocates the grid; it also
+                // counts the edges every timed solve evaluates
+                SolverWorkspace workspace;
+#ifdef HW_PROFILE
+                profile_take();
+#endif
+                take_edges_evaluated();
+                TrajectoryResult result = solve_trajectory_grid(criterion, scenario, workspace, threads);
+                long long edges = max(take_edges_evaluated(), 1LL);
+#ifdef HW_PROFILE
+                SolverCounters counters = profile_take();
+#endif
+
+                vector<double> times;
+                for (int r = 0; r < options.repeat; r++) {
+                    auto start = chrono::steady_clock::now();
+                    solve_trajectory_grid(criterion, scenario, workspace, threads);
+                    auto stop = chrono::steady_clock::now();
+                    times.push_back(chrono::duration<double, milli>(stop - start).count());
+                }
+                sort(times.begin(), times.end());
+                double best_ms = times.front();
+                double median_ms = times[times.size() / 2];
+                if (threads == 1) single_thread_ms = best_ms;
+
+                out << (first_run ? "\n" : ",\n") << "    {"
+                    << "\"nh\": " << NH << ", \"nv\": " << NV << ", "
+                    << "\"criterion\": \"" << (criterion == MIN_TIME ? "time" : "fuel") << "\", "
+                    << "\"threads\": " << threads << ", \"edges\": " << edges << ", "
+                    << "\"best_ms\": " << best_ms << ", \"median_ms\": " << median_ms << ", "
+                    << "\"ns_per_edge\": " << best_ms * 1e6 / edges << ", "
+                    << "\"speedup\": " << single_thread_ms / best_ms << ", "
+                    << "\"process_peak_rss_kb\": " << peak_rss_kb() << ", "
+                    << "\"status\": \"" << (result.path.empty() ? "no_path" : "ok") << "\"";
+                if (!result.path.empty()) {
+                    out << setprecision(numeric_limits<double>::max_digits10)
+                        << ", \"total_time_s\": " << result.total_time
+                        << ", \"total_fuel_kg\": " << result.total_fuel << setprecision(6);
+                }
+#ifdef HW_PROFILE
+                // Counts of the warm-up solve; timed runs repeat the same work
+                out << ", \"counters\": {\"edges_evaluated\": " << counters.edges_evaluated;
+                for (int r = REJECT_GEOMETRY; r < REJECT_REASONS; r++) {
+                    out << ", \"rejected_" << REJECT_REASON_NAMES[r] << "\": " << counters.rejected[r];
+                }
+                out << ", \"relaxations\": " << counters.relaxations
+                    << ", \"improvements\": " << counters.improvements;
+                const char* const kernels[3] = {"acceleration", "climb", "combined"};
+                for (int m = 0; m < 3; m++) {
+                    out << ", \"" << kernels[m] << "_calls\": " << counters.kernel_calls[m]
+                        << ", \"" << kernels[m] << "_edges\": " << counters.kernel_lanes[m]
+                        << ", \"" << kernels[m] << "_ms\": " << counters.kernel_ns[m] * 1e-6;
+                }
+                out << "}";
+#endif
+                out << "}";
+                out.flush();
+                first_run = false;
+            }
+        }
+    }
+    out << "\n  ]\n}\n";
+    return 0;
+}
+
 // ========== MAIN FUNCTION ==========
-int main() {
+int main(int argc, char* argv[]) {
     try {
+        if (argc > 1 && string(argv[1]) == "--bench") {
+            return run_bench(argc, argv);
+        }
+        if (argc > 1 && string(argv[1]) == "--convert") {
+            return run_convert(argc, argv);
+        }
+        // Options select the non-interactive batch mode
+        if (argc > 1 && argv[1][0] == '-') {
+            return run_batch(argc, argv);
+        }
+
         cout << "==========================================\n";
         cout << " TU-134 TRAJECTORY OPTIMIZATION\n";
         cout << " GRID-BASED METHOD\n";
         cout << "==========================================\n\n";
 
         cout << "AIRCRAFT PARAMETERS:\n";
-        cout << " Total mass (with fuel): " << TU134_MASS << " kg\n";
-        cout << " Wing area: " << TU134_WING_AREA << " m²\n";
-        cout << " Thrust: " << TU134_NOMINAL_THRUST/1000 << " kN (2xD-30)\n";
+        cout << " Total mass (with fuel): " << Tu134::mass << " kg\n";
+        cout << " Wing area: " << Tu134::wing_area << " m²\n";
+        cout << " Thrust: " << Tu134::nominal_thrust/1000 << " kN (2xD-30)\n";
         cout << " Initial altitude: " << INITIAL_ALTITUDE << " m\n";
         cout << " Final altitude: " << FINAL_ALTITUDE << " m\n";
         cout << " Initial velocity: " << INITIAL_VELOCITY*3.6 << " km/h\n";
         cout << " Final velocity: " << FINAL_VELOCITY*3.6 << " km/h\n";
-        cout << " Grid size: N = " << N << " points\n\n";
+        // Optional command line: HW [NH [NV [MASS_STEP]]]
+        Scenario scenario;
+        if (argc > 1) scenario.NH = scenario.NV = stoi(argv[1]);
+        if (argc > 2) scenario.NV = stoi(argv[2]);
+        if (argc > 3) scenario.mass_step = stod(argv[3]);
+
+        cout << " Grid size: NH = " << scenario.NH << ", NV = " << scenario.NV << " steps\n";
+        if (scenario.mass_step > 0) {
+            cout << " Mass state: buckets of " << scenario.mass_step << " kg\n";
+        }
+        cout << "\n";
 
         int choice;
         cout << "Select optimization criterion:\n";
         cout << "1 - Minimum time\n";
         cout << "2 - Minimum fuel consumption\n";
         cout << "3 - Compare both\n";
-        cout << "Your choice (1, 2 or 3): ";
+        cout << "4 - Pareto front (time vs fuel)\n";
+        cout << "Your choice (1-4): ";
         cin >> choice;
 
         TrajectoryResult time_traj, fuel_traj;
+        SolverWorkspace workspace;
 
         if (choice == 1) {
-            time_traj = solve_trajectory_grid(MIN_TIME);
+            time_traj = solve_trajectory_grid(MIN_TIME, scenario, workspace);
+            print_trajectory_report(time_traj, MIN_TIME);
 
             char plot_choice;
             cout << "\nDo you want to create a plot for this trajectory? (y/n): ";
@@ -709,7 +4623,8 @@ int main() {
             }
         }
         else if (choice == 2) {
-            fuel_traj = solve_trajectory_grid(MIN_FUEL);
+            fuel_traj = solve_trajectory_grid(MIN_FUEL, scenario, workspace);
+            print_trajectory_report(fuel_traj, MIN_FUEL);
 
             char plot_choice;
             cout << "\nDo you want to create a plot for this trajectory? (y/n): ";
@@ -721,10 +4636,12 @@ int main() {
         }
         else if (choice == 3) {
             cout << "\n=== MINIMUM TIME TRAJECTORY ===\n";
-            time_traj = solve_trajectory_grid(MIN_TIME);
+            time_traj = solve_trajectory_grid(MIN_TIME, scenario, workspace);
+            print_trajectory_report(time_traj, MIN_TIME);
 
             cout << "\n=== MINIMUM FUEL TRAJECTORY ===\n";
-            fuel_traj = solve_trajectory_grid(MIN_FUEL);
+            fuel_traj = solve_trajectory_grid(MIN_FUEL, scenario, workspace);
+            print_trajectory_report(fuel_traj, MIN_FUEL);
 
             // Comparison table
             if (!time_traj.path.empty() && !fuel_traj.path.empty()) {
@@ -795,9 +4712,15 @@ int main() {
                 }
             }
         }
+        else if (choice == 4) {
+            print_pareto_report(solve_pareto_front(scenario, workspace));
+        }
         else {
             cout << "\nInvalid choice!\n";
         }
+#ifdef HW_PROFILE
+        print_profile_counters(profile_take(), cout);
+#endif
 
     } catch (const exception& e) {
         cerr << "\nERROR: " << e.what() << "\n";
@@ -0,0 +1,260 @@
+// Binary trajectory files (.hwt) written by HW --paths_binary and read by
+// HW --convert; the header has no dependencies on HW.cpp, so other tools can
+// read the files the same way.
+//
+// Layout, native byte order, every block a multiple of 8 bytes:
+//   TrajectoryFileHeader (64 bytes)
+//   per trajectory: TrajectoryRecordHeader (64 bytes), then point_count
+//   doubles each of altitude (m), velocity (m/s), time (s), mass (kg) and
+//   burnt fuel (kg), then point_count maneuver bytes (0 at the start point)
+//   padded with zeros to a multiple of 8
+// The header's checksum is FNV-1a (64-bit) over everything after the header.
+// The columns are aligned, so a reader can map the file and use them in place.
+#ifndef TRAJECTORY_FILE_H
+#define TRAJECTORY_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const char TRAJECTORY_FILE_MAGIC[8] = {'H', 'W', 'T', 'R', 'J', '1', 0, 0};
+const uint32_t TRAJECTORY_BYTE_ORDER = 0x01020304;
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const uint64_t FNV_PRIME = 1099511628211ULL;
+
+struct TrajectoryFileHeader {
+    char magic[8];
+    uint32_t byte_order;         // TRAJECTORY_BYTE_ORDER as written
+    uint32_t header_size;        // sizeof(TrajectoryFileHeader)
+    uint32_t record_header_size; // sizeof(TrajectoryRecordHeader)
+    uint32_t reserved;
+    uint64_t trajectory_count;
+    uint64_t payload_bytes;      // everything after this header
+    uint64_t checksum;
+    uint64_t reserved2[2];
+};
+
+struct TrajectoryRecordHeader {
+    uint64_t point_count;
+    uint32_t case_number;
+    uint32_t reserved;
+    char label[16];              // criterion: time, fuel, pareto1, ...
+    double total_time;
+    double total_fuel;
+    double avg_climb_rate;
+    double reserved2;
+};
+
+static_assert(sizeof(TrajectoryFileHeader) == 64, "trajectory file header must be 64 bytes");
+static_assert(sizeof(TrajectoryRecordHeader) == 64, "trajectory record header must be 64 bytes");
+
+inline uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t k = 0; k < size; k++) {
+        hash ^= bytes[k];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+inline size_t maneuver_column_bytes(uint64_t point_count) {
+    return (size_t)((point_count + 7) / 8 * 8);
+}
+
+// Bytes of one record with point_count points, header included
+inline size_t trajectory_record_bytes(uint64_t point_count) {
+    return sizeof(TrajectoryRecordHeader) + (size_t)(5 * point_count * sizeof(double)) +
+           maneuver_column_bytes(point_count);
+}
+
+// Streams records to a file; close() fills in the count and the checksum
+class TrajectoryFileWriter {
+private:
+    std::ofstream out;
+    std::string file;
+    TrajectoryFileHeader header;
+
+public:
+    TrajectoryFileWriter() { std::memset(&header, 0, sizeof(header)); }
+
+    void open(const std::string& name) {
+        file = name;
+        out.open(file.c_str(), std::ios::binary);
+        if (!out) throw std::runtime_error("cannot open trajectory file " + file);
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, TRAJECTORY_FILE_MAGIC, sizeof(header.magic));
+        header.byte_order = TRAJECTORY_BYTE_ORDER;
+        header.header_size = sizeof(TrajectoryFileHeader);
+        header.record_header_size = sizeof(TrajectoryRecordHeader);
+        header.checksum = FNV_OFFSET_BASIS;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    bool is_open() const { return out.is_open(); }
+
+    // records: count complete records, each a header followed by its columns
+    void append(const std::string& records, size_t count) {
+        out.write(records.data(), records.size());
+        header.checksum = fnv1a(header.checksum, records.data(), records.size());
+        header.payload_bytes += records.size();
+        header.trajectory_count += count;
+    }
+
+    void close() {
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.close();
+        if (!out) throw std::runtime_error("cannot write trajectory file " + file);
+    }
+};
+
+// One trajectory of a mapped file; the pointers refer to the mapping
+struct TrajectoryView {
+    const TrajectoryRecordHeader* header;
+    const double* altitude;
+    const double* velocity;
+    const double* time;
+    const double* mass;
+    const double* fuel;
+    const unsigned char* maneuver;
+
+    size_t size() const { return (size_t)header->point_count; }
+    std::string label() const { return std::string(header->label, strnlen(header->label, sizeof(header->label))); }
+};
+
+// Read-only memory mapping of a trajectory file. Only the record headers are
+// read on open (and every byte once if verify is set to check the checksum);
+// the columns are paged in when used.
+class TrajectoryFileReader {
+private:
+    const unsigned char* data;
+    size_t size;
+    std::vector<TrajectoryView> records;
+#ifdef _WIN32
+    HANDLE file_handle, mapping;
+#endif
+
+    TrajectoryFileReader(const TrajectoryFileReader&);
+    TrajectoryFileReader& operator=(const TrajectoryFileReader&);
+
+    void map(const std::string& file) {
+#ifdef _WIN32
+        file_handle = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file_handle == INVALID_HANDLE_VALUE) throw std::runtime_error("cannot open trajectory file " + file);
+        LARGE_INTEGER file_size;
+        GetFileSizeEx(file_handle, &file_size);
+        size = (size_t)file_size.QuadPart;
+        if (size < sizeof(TrajectoryFileHeader)) return;
+        mapping = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping) data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+        int fd = ::open(file.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("cannot open trajectory file " + file);
+        struct stat info;
+        if (fstat(fd, &info) == 0) size = (size_t)info.st_size;
+        if (size >= sizeof(TrajectoryFileHeader)) {
+            void* address = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) data = static_cast<const unsigned char*>(address);
+        }
+        ::close(fd);
+#endif
+        if (!data) {
+            unmap();
+            throw std::runtime_error(file + ": not a trajectory file");
+        }
+    }
+
+    void unmap() {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+        if (file_handle != INVALID_HANDLE_VALUE) CloseHandle(file_handle);
+        mapping = NULL;
+        file_handle = INVALID_HANDLE_VALUE;
+#else
+        if (data) munmap(const_cast<unsigned char*>(data), size);
+#endif
+        data = NULL;
+    }
+
+public:
+    explicit TrajectoryFileReader(const std::string& file, bool verify = true) : data(NULL), size(0) {
+#ifdef _WIN32
+        file_handle = INVALID_HANDLE_VALUE;
+        mapping = NULL;
+#endif
+        map(file);
+        try {
+            const TrajectoryFileHeader* header = reinterpret_cast<const TrajectoryFileHeader*>(data);
+            if (std::memcmp(header->magic, TRAJECTORY_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+                header->header_size != sizeof(TrajectoryFileHeader) ||
+                header->record_header_size != sizeof(TrajectoryRecordHeader)) {
+                throw std::runtime_error(file + ": not a trajectory file");
+            }
+            if (header->byte_order != TRAJECTORY_BYTE_ORDER) {
+                throw std::runtime_error(file + ": written with a different byte order");
+            }
+            if (header->payload_bytes != size - sizeof(TrajectoryFileHeader)) {
+                throw std::runtime_error(file + ": truncated trajectory file");
+            }
+            if (verify && fnv1a(FNV_OFFSET_BASIS, data + sizeof(TrajectoryFileHeader),
+                                size - sizeof(TrajectoryFileHeader)) != header->checksum) {
+                throw std::runtime_error(file + ": checksum mismatch");
+            }
+
+            size_t offset = sizeof(TrajectoryFileHeader);
+            for (uint64_t k = 0; k < header->trajectory_count; k++) {
+                if (size - offset < sizeof(TrajectoryRecordHeader)) {
+                    throw std::runtime_error(file + ": truncated trajectory file");
+                }
+                TrajectoryView view;
+                view.header = reinterpret_cast<const TrajectoryRecordHeader*>(data + offset);
+                uint64_t n = view.header->point_count;
+                size_t available = size - offset - sizeof(TrajectoryRecordHeader);
+                if (n > available / (5 * sizeof(double) + 1) ||
+                    5 * n * sizeof(double) + maneuver_column_bytes(n) > available) {
+                    throw std::runtime_error(file + ": truncated trajectory file");
+                }
+                const double* column = reinterpret_cast<const double*>(data + offset + sizeof(TrajectoryRecordHeader));
+                view.altitude = column;
+                view.velocity = column + n;
+                view.time = column + 2 * n;
+                view.mass = column + 3 * n;
+                view.fuel = column + 4 * n;
+                view.maneuver = reinterpret_cast<const unsigned char*>(column + 5 * n);
+                records.push_back(view);
+                offset += trajectory_record_bytes(n);
+            }
+        } catch (...) {
+            unmap();
+            throw;
+        }
+    }
+
+    ~TrajectoryFileReader() { unmap(); }
+
+    size_t count() const { return records.size(); }
+    const TrajectoryView& operator[](size_t k) const { return records[k]; }
+};
+
+#endif
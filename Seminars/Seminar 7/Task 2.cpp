@@ -6,6 +6,7 @@
 #include <cstdlib>
 #include <sstream>
 #include <algorithm>
+#include "gnuplot_pipe.h"
 
 using namespace std;
 
@@ -80,82 +81,66 @@ public:
         cout << "Max delta: " << max_delta << " m" << endl;
         cout << "Min delta: " << min_delta << " m" << endl;
 
-        ofstream s1("sensor1_data.txt");
-        ofstream s2("sensor2_data.txt");
-        ofstream diff("delta_data.txt");
-
-        for (size_t i = 0; i < t.size(); ++i) {
-            s1 << t[i] << " " << h1[i] << "\n";
-            s2 << t[i] << " " << h2[i] << "\n";
-            diff << t[i] << " " << delta[i] << "\n";
+        if (!gnuplot_available()) {
+            cout << "\nGNUPlot not found: install it to get the plots." << endl;
+            return;
         }
 
-        s1.close(); s2.close(); diff.close();
-
-        ofstream script("plot_comparison.gp");
-        script << "# Sensor data comparison plot\n";
-        script << "set terminal qt size 900,700\n";
-        script << "set multiplot layout 2,1\n";
-        script << "set style data linespoints\n\n";
-
-        script << "# Top plot: Both sensors\n";
-        script << "set title 'Altitude Measurements from Two Sensors'\n";
-        script << "set xlabel 'Time (s)'\n";
-        script << "set ylabel 'Altitude (m)'\n";
-        script << "set grid\n";
-        script << "set key top left\n";
-        script << "plot 'sensor1_data.txt' using 1:2 pt 7 ps 1.5 lc rgb 'blue' title 'Sensor 1', \\\n";
-        script << "     'sensor2_data.txt' using 1:2 pt 9 ps 1.5 lc rgb 'green' title 'Sensor 2'\n\n";
-
-        script << "# Bottom plot: Difference\n";
-        script << "set title 'Difference Between Sensors (Δh)'\n";
-        script << "set xlabel 'Time (s)'\n";
-        script << "set ylabel 'Difference (m)'\n";
-        script << "set grid\n";
-        script << "set yrange [0:" << (max_delta * 1.2) << "]\n";
-        script << "plot 'delta_data.txt' using 1:2 pt 5 ps 2 lc rgb 'red' lw 3 title 'Δh = |h1 - h2|'\n";
-
-        script << "unset multiplot\n";
-        script << "pause mouse 'Click to close'\n";
-        script.close();
-
-        cout << "\n=== GNUPlot Script Created ===" << endl;
-        cout << "File: plot_comparison.gp" << endl;
+        // Both plots go through one gnuplot process; the data is streamed
+        // to it in binary, no data files or scripts are written
+        GnuplotPipe gp;
+        string series = GnuplotPipe::binarySource(t.size(), 2);
+
+        gp.output("plot_comparison.png", 900, 700);
+        gp.command("set multiplot layout 2,1\n");
+        gp.command("set style data linespoints\n");
+
+        // Top plot: both sensors
+        gp.command("set title 'Altitude Measurements from Two Sensors'\n");
+        gp.command("set xlabel 'Time (s)'\n");
+        gp.command("set ylabel 'Altitude (m)'\n");
+        gp.command("set grid\n");
+        gp.command("set key top left\n");
+        gp.command("plot " + series + " using 1:2 pt 7 ps 1.5 lc rgb 'blue' title 'Sensor 1', " +
+                   series + " using 1:2 pt 9 ps 1.5 lc rgb 'green' title 'Sensor 2'\n");
+        gp.data(t, h1);
+        gp.data(t, h2);
+
+        // Bottom plot: difference
+        gp.command("set title 'Difference Between Sensors (Δh)'\n");
+        gp.command("set xlabel 'Time (s)'\n");
+        gp.command("set ylabel 'Difference (m)'\n");
+        gp.command("set yrange [0:" + to_string(max_delta * 1.2) + "]\n");
+        gp.command("plot " + series + " using 1:2 pt 5 ps 2 lc rgb 'red' lw 3 title 'Δh = |h1 - h2|'\n");
+        gp.data(t, delta);
+        gp.command("unset multiplot\n");
+
+        cout << "\n=== GNUPlot Plots ===" << endl;
+        cout << "File: plot_comparison.png" << endl;
         cout << "\nThe plot shows:" << endl;
         cout << "1. TOP: Both altitude sensors (1000-1060 m scale)" << endl;
         cout << "2. BOTTOM: Difference between them (0-" << max_delta << " m scale)" << endl;
 
-        ofstream script2("plot_combined.gp");
-        script2 << "# Combined plot with two y-axes\n";
-        script2 << "set terminal qt\n";
-        script2 << "set title 'Sensor Data with Delta (Right Axis)'\n";
-        script2 << "set xlabel 'Time (s)'\n";
-        script2 << "set ylabel 'Altitude (m)'\n";
-        script2 << "set y2label 'Delta (m)'\n";
-        script2 << "set ytics nomirror\n";
-        script2 << "set y2tics\n";
-        script2 << "set grid\n";
-        script2 << "set yrange [990:1070]\n";
-        script2 << "set y2range [0:" << (max_delta * 1.5) << "]\n";
-        script2 << "plot 'sensor1_data.txt' using 1:2 with linespoints title 'Sensor 1', \\\n";
-        script2 << "     'sensor2_data.txt' using 1:2 with linespoints title 'Sensor 2', \\\n";
-        script2 << "     'delta_data.txt' using 1:2 axes x1y2 with lines lw 3 title 'Delta h'\n";
-        script2 << "pause mouse\n";
-        script2.close();
-
-        cout << "\nAlternative plot: plot_combined.gp (delta on right axis)" << endl;
-
-        cout << "\n=== Launching GNUPlot ===" << endl;
-        cout << "Choose plot type:" << endl;
-        cout << "1. Two separate plots (recommended): plot_comparison.gp" << endl;
-        cout << "2. Combined with two y-axes: plot_combined.gp" << endl;
-
-        int result = system("gnuplot -p plot_comparison.gp 2>/dev/null");
-        if (result != 0) {
-            cout << "\nGNUPlot not found or failed to launch." << endl;
-            cout << "Please install GNUPlot or run manually:" << endl;
-            cout << "  gnuplot -p plot_comparison.gp" << endl;
-        }
+        // Combined plot with two y-axes
+        gp.output("plot_combined.png");
+        gp.command("reset\n");
+        gp.command("set title 'Sensor Data with Delta (Right Axis)'\n");
+        gp.command("set xlabel 'Time (s)'\n");
+        gp.command("set ylabel 'Altitude (m)'\n");
+        gp.command("set y2label 'Delta (m)'\n");
+        gp.command("set ytics nomirror\n");
+        gp.command("set y2tics\n");
+        gp.command("set grid\n");
+        gp.command("set yrange [990:1070]\n");
+        gp.command("set y2range [0:" + to_string(max_delta * 1.5) + "]\n");
+        gp.command("plot " + series + " using 1:2 with linespoints title 'Sensor 1', " +
+                   series + " using 1:2 with linespoints title 'Sensor 2', " +
+                   series + " using 1:2 axes x1y2 with lines lw 3 title 'Delta h'\n");
+        gp.data(t, h1);
+        gp.data(t, h2);
+        gp.data(t, delta);
+
+        cout << "\nAlternative plot: plot_combined.png (delta on right axis)" << endl;
     }
 };
 
@@ -178,15 +163,8 @@ int main() {
     cout << "\n===== TASK 2 COMPLETED =====" << endl;
     cout << "\nFiles created:" << endl;
     cout << "  sensors.txt          - Raw data" << endl;
-    cout << "  sensor1_data.txt     - Sensor 1 data" << endl;
-    cout << "  sensor2_data.txt     - Sensor 2 data" << endl;
-    cout << "  delta_data.txt       - Difference data" << endl;
-    cout << "  plot_comparison.gp   - Main plot script" << endl;
-    cout << "  plot_combined.gp     - Alternative plot" << endl;
-
-    cout << "\nTo view plots manually:" << endl;
-    cout << "  gnuplot -p plot_comparison.gp" << endl;
-    cout << "  gnuplot -p plot_combined.gp" << endl;
+    cout << "  plot_comparison.png  - Main plot" << endl;
+    cout << "  plot_combined.png    - Alternative plot" << endl;
 
     return 0;
 }
@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include "gnuplot_pipe.h"
 
 using namespace std;
 
@@ -103,67 +104,53 @@ public:
         }
         fout.close();
 
-        // Также создаем текстовые файлы для GNUPlot
-        ofstream raw("raw_data.txt");
-        ofstream filt("filtered_data.txt");
-
-        raw << "# Raw altitude data\n";
-        filt << "# Filtered altitude data (900-1100 m)\n";
+        if (!gnuplot_available()) {
+            cout << "\nGNUPlot not found: install it to get the plot." << endl;
+            return;
+        }
 
+        // Данные передаются в GNUPlot через канал в двоичном виде
+        vector<double> raw_t, raw_h, filt_t, filt_h;
         for (const auto& p : data) {
-            raw << p.first << " " << p.second << "\n";
+            raw_t.push_back(p.first);
+            raw_h.push_back(p.second);
         }
-
         for (const auto& p : filtered) {
-            filt << p.first << " " << p.second << "\n";
+            filt_t.push_back(p.first);
+            filt_h.push_back(p.second);
         }
 
-        raw.close();
-        filt.close();
-
-        // Создаем скрипт GNUPlot
-        ofstream script("plot_filtering.gp");
-        script << "# Altitude data filtering\n";
-        script << "set terminal qt size 900,600\n";
-        script << "set multiplot layout 2,1\n\n";
+        GnuplotPipe gp;
+        gp.output("plot_filtering.png", 900, 600);
+        gp.command("set multiplot layout 2,1\n");
 
         // Верхний график: исходные данные
-        script << "# Top: Raw data with bounds\n";
-        script << "set title 'Raw Altitude Data with Outliers'\n";
-        script << "set xlabel 'Time (s)'\n";
-        script << "set ylabel 'Altitude (m)'\n";
-        script << "set grid\n";
-        script << "set yrange [800:1600]\n";
-        script << "set arrow from graph 0, first " << minAlt << " to graph 1, first " << minAlt << " nohead lc rgb 'red' lw 2\n";
-        script << "set arrow from graph 0, first " << maxAlt << " to graph 1, first " << maxAlt << " nohead lc rgb 'red' lw 2\n";
-        script << "plot 'raw_data.txt' using 1:2 with points pt 7 ps 1.5 lc rgb 'blue' title 'Raw Data'\n\n";
+        gp.command("set title 'Raw Altitude Data with Outliers'\n");
+        gp.command("set xlabel 'Time (s)'\n");
+        gp.command("set ylabel 'Altitude (m)'\n");
+        gp.command("set grid\n");
+        gp.command("set yrange [800:1600]\n");
+        gp.command("set arrow from graph 0, first " + to_string(minAlt) + " to graph 1, first " +
+                   to_string(minAlt) + " nohead lc rgb 'red' lw 2\n");
+        gp.command("set arrow from graph 0, first " + to_string(maxAlt) + " to graph 1, first " +
+                   to_string(maxAlt) + " nohead lc rgb 'red' lw 2\n");
+        gp.command("plot " + GnuplotPipe::binarySource(raw_t.size(), 2) +
+                   " using 1:2 with points pt 7 ps 1.5 lc rgb 'blue' title 'Raw Data'\n");
+        gp.data(raw_t, raw_h);
 
         // Нижний график: отфильтрованные данные
-        script << "# Bottom: Filtered data\n";
-        script << "set title 'Filtered Data (900-1100 m range)'\n";
-        script << "set xlabel 'Time (s)'\n";
-        script << "set ylabel 'Altitude (m)'\n";
-        script << "set grid\n";
-        script << "set yrange [" << (minAlt-10) << ":" << (maxAlt+10) << "]\n";
-        script << "plot 'filtered_data.txt' using 1:2 with linespoints pt 5 ps 1.5 lc rgb 'green' title 'Filtered'\n";
-
-        script << "unset multiplot\n";
-        script << "pause mouse\n";
-        script.close();
-
-        cout << "\n=== Created GNUPlot Script ===" << endl;
-        cout << "File: plot_filtering.gp" << endl;
+        gp.command("set title 'Filtered Data (900-1100 m range)'\n");
+        gp.command("set yrange [" + to_string(minAlt - 10) + ":" + to_string(maxAlt + 10) + "]\n");
+        gp.command("plot " + GnuplotPipe::binarySource(filt_t.size(), 2) +
+                   " using 1:2 with linespoints pt 5 ps 1.5 lc rgb 'green' title 'Filtered'\n");
+        gp.data(filt_t, filt_h);
+        gp.command("unset multiplot\n");
+
+        cout << "\n=== GNUPlot Plot ===" << endl;
+        cout << "File: plot_filtering.png" << endl;
         cout << "\nThe plot shows:" << endl;
         cout << "1. TOP: Raw data with red lines showing filter bounds" << endl;
         cout << "2. BOTTOM: Filtered data within 900-1100 m range" << endl;
-
-        // Запускаем GNUPlot
-        cout << "\n=== Launching Plot ===" << endl;
-        int result = system("gnuplot -p plot_filtering.gp 2>/dev/null");
-        if (result != 0) {
-            cout << "Could not launch GNUPlot automatically." << endl;
-            cout << "Please run manually: gnuplot -p plot_filtering.gp" << endl;
-        }
     }
 };
 
@@ -187,9 +174,7 @@ int main() {
     cout << "\nFiles created:" << endl;
     cout << "  altitude.csv       - Original CSV data" << endl;
     cout << "  filtered.csv       - Filtered CSV data" << endl;
-    cout << "  raw_data.txt       - Raw data for GNUPlot" << endl;
-    cout << "  filtered_data.txt  - Filtered data for GNUPlot" << endl;
-    cout << "  plot_filtering.gp  - GNUPlot script" << endl;
+    cout << "  plot_filtering.png - GNUPlot plot" << endl;
 
     return 0;
 }
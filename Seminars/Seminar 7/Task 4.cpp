@@ -5,6 +5,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <algorithm>
+#include "gnuplot_pipe.h"
 
 using namespace std;
 
@@ -119,82 +120,69 @@ public:
         fout.close();
         cout << "\nVelocity data saved to " << outfile << " as required" << endl;
 
-        // Create data files for GNUPlot
-        ofstream traj("trajectory_data.txt");
-        ofstream speed("speed_data.txt");
-
-        traj << "# Trajectory data\n";
-        speed << "# Speed data\n";
+        if (!gnuplot_available()) {
+            cout << "\nGNUPlot not found: install it to get the plots." << endl;
+            return;
+        }
 
+        // Records (t, x, y) for the trajectory plots, streamed in binary
+        vector<double> track;
         for (size_t i = 0; i < t.size(); ++i) {
-            traj << t[i] << " " << x[i] << " " << y[i] << "\n";
-            speed << t[i] << " " << v[i] << "\n";
+            track.push_back(t[i]);
+            track.push_back(x[i]);
+            track.push_back(y[i]);
         }
+        string track_source = GnuplotPipe::binarySource(t.size(), 3);
 
-        traj.close();
-        speed.close();
-
-        // Create GNUPlot script
-        ofstream script("plot_navigation.gp");
-        script << "# Navigation data analysis\n";
-        script << "set terminal qt size 1000,700\n";
-        script << "set multiplot layout 2,2\n\n";
+        GnuplotPipe gp;
+        gp.output("plot_navigation.png", 1000, 700);
+        gp.command("set multiplot layout 2,2\n");
 
         // График 1: Траектория в пространстве
-        script << "# Plot 1: 2D Trajectory\n";
-        script << "set title '2D Trajectory'\n";
-        script << "set xlabel 'X position (m)'\n";
-        script << "set ylabel 'Y position (m)'\n";
-        script << "set grid\n";
-        script << "set size square\n";
-        script << "plot 'trajectory_data.txt' using 2:3 with linespoints pt 7 ps 1.5 lc rgb 'blue' title 'Path'\n\n";
+        gp.command("set title '2D Trajectory'\n");
+        gp.command("set xlabel 'X position (m)'\n");
+        gp.command("set ylabel 'Y position (m)'\n");
+        gp.command("set grid\n");
+        gp.command("set size square\n");
+        gp.command("plot " + track_source + " using 2:3 with linespoints pt 7 ps 1.5 lc rgb 'blue' title 'Path'\n");
+        gp.data(track.data(), t.size(), 3);
 
         // График 2: X и Y отдельно
-        script << "# Plot 2: Position vs Time\n";
-        script << "set title 'Position Components vs Time'\n";
-        script << "set xlabel 'Time (s)'\n";
-        script << "set ylabel 'Position (m)'\n";
-        script << "set grid\n";
-        script << "plot 'trajectory_data.txt' using 1:2 with linespoints title 'X(t)', \\\n";
-        script << "     '' using 1:3 with linespoints title 'Y(t)'\n\n";
+        gp.command("set size nosquare\n");
+        gp.command("set title 'Position Components vs Time'\n");
+        gp.command("set xlabel 'Time (s)'\n");
+        gp.command("set ylabel 'Position (m)'\n");
+        gp.command("plot " + track_source + " using 1:2 with linespoints title 'X(t)', " +
+                   track_source + " using 1:3 with linespoints title 'Y(t)'\n");
+        gp.data(track.data(), t.size(), 3);
+        gp.data(track.data(), t.size(), 3);
 
         // График 3: Скорость
-        script << "# Plot 3: Speed vs Time\n";
-        script << "set title 'Speed Magnitude vs Time'\n";
-        script << "set xlabel 'Time (s)'\n";
-        script << "set ylabel 'Speed (m/s)'\n";
-        script << "set grid\n";
-        script << "set yrange [0:" << (max_v * 1.2) << "]\n";
-        script << "plot 'speed_data.txt' using 1:2 with linespoints pt 5 ps 1.5 lc rgb 'red' lw 2 title 'v(t)'\n\n";
+        gp.command("set title 'Speed Magnitude vs Time'\n");
+        gp.command("set xlabel 'Time (s)'\n");
+        gp.command("set ylabel 'Speed (m/s)'\n");
+        gp.command("set yrange [0:" + to_string(max_v * 1.2) + "]\n");
+        gp.command("plot " + GnuplotPipe::binarySource(t.size(), 2) +
+                   " using 1:2 with linespoints pt 5 ps 1.5 lc rgb 'red' lw 2 title 'v(t)'\n");
+        gp.data(t, v);
 
         // График 4: 3D траектория
-        script << "# Plot 4: 3D View (time as Z)\n";
-        script << "set title '3D Trajectory (Time as Z-axis)'\n";
-        script << "set xlabel 'X (m)'\n";
-        script << "set ylabel 'Y (m)'\n";
-        script << "set zlabel 'Time (s)'\n";
-        script << "set grid\n";
-        script << "splot 'trajectory_data.txt' using 2:3:1 with linespoints pt 7 ps 1.5 title '3D Path'\n";
-
-        script << "unset multiplot\n";
-        script << "pause mouse\n";
-        script.close();
-
-        cout << "\n=== Created GNUPlot Script ===" << endl;
-        cout << "File: plot_navigation.gp" << endl;
+        gp.command("set autoscale y\n");
+        gp.command("set title '3D Trajectory (Time as Z-axis)'\n");
+        gp.command("set xlabel 'X (m)'\n");
+        gp.command("set ylabel 'Y (m)'\n");
+        gp.command("set zlabel 'Time (s)'\n");
+        gp.command("splot " + track_source + " using 2:3:1 with linespoints pt 7 ps 1.5 title '3D Path'\n");
+        gp.data(track.data(), t.size(), 3);
+        gp.command("unset multiplot\n");
+
+        cout << "\n=== GNUPlot Plot ===" << endl;
+        cout << "File: plot_navigation.png" << endl;
         cout << "\nThe plot shows 4 graphs:" << endl;
         cout << "1. 2D Trajectory (X-Y plane)" << endl;
         cout << "2. Position components vs time" << endl;
         cout << "3. Speed magnitude vs time" << endl;
         cout << "4. 3D trajectory with time as Z-axis" << endl;
-
-        // Запускаем GNUPlot
-        cout << "\n=== Launching Plot ===" << endl;
-        int result = system("gnuplot -p plot_navigation.gp 2>/dev/null");
-        if (result != 0) {
-            cout << "Could not launch GNUPlot automatically." << endl;
-            cout << "Please run manually: gnuplot -p plot_navigation.gp" << endl;
-        }
     }
 };
 
@@ -217,9 +205,7 @@ int main() {
     cout << "\nFiles created:" << endl;
     cout << "  navigation.csv     - Original trajectory data" << endl;
     cout << "  velocity.csv       - Computed speed data" << endl;
-    cout << "  trajectory_data.txt- Formatted trajectory data" << endl;
-    cout << "  speed_data.txt     - Formatted speed data" << endl;
-    cout << "  plot_navigation.gp - GNUPlot script with 4 plots" << endl;
+    cout << "  plot_navigation.png- GNUPlot plot with 4 graphs" << endl;
 
     return 0;
 }
@@ -6,6 +6,7 @@
 #include <cstdlib>
 #include <algorithm>  // для max_element, min_element
 #include <numeric>    // для accumulate
+#include "gnuplot_pipe.h"
 
 using namespace std;
 
@@ -153,75 +154,46 @@ public:
     }
 
     void plotResults() {
-        // Создаем файлы данных для GNUPlot
-        ofstream pos("position_data.txt");
-        ofstream vel("velocity_data.txt");
-        ofstream acc("acceleration_data.txt");
-
-        pos << "# Position data\n";
-        vel << "# Velocity data\n";
-        acc << "# Acceleration data\n";
-
-        for (size_t i = 0; i < t.size(); ++i) {
-            pos << t[i] << " " << x[i] << "\n";
-            vel << t[i] << " " << v[i] << "\n";
-            acc << t[i] << " " << a[i] << "\n";
+        if (!gnuplot_available()) {
+            cout << "\nGNUPlot not found: install it to get the plot." << endl;
+            return;
         }
 
-        pos.close(); vel.close(); acc.close();
-
-        // Создаем скрипт GNUPlot
-        ofstream script("plot_motion.gp");
-        script << "# Motion analysis: position, velocity, acceleration\n";
-        script << "set terminal qt size 1200,800\n";
-        script << "set multiplot layout 3,1\n\n";
+        // Данные передаются в GNUPlot через канал в двоичном виде
+        string series = GnuplotPipe::binarySource(t.size(), 2);
+        GnuplotPipe gp;
+        gp.output("plot_motion.png", 1200, 800);
+        gp.command("set multiplot layout 3,1\n");
 
         // График 1: Положение
-        script << "# Plot 1: Position\n";
-        script << "set title 'Position vs Time'\n";
-        script << "set xlabel 'Time (s)'\n";
-        script << "set ylabel 'Position (m)'\n";
-        script << "set grid\n";
-        script << "set key top left\n";
-        script << "plot 'position_data.txt' using 1:2 with linespoints pt 7 ps 1.5 lc rgb 'blue' title 'x(t)'\n\n";
+        gp.command("set title 'Position vs Time'\n");
+        gp.command("set xlabel 'Time (s)'\n");
+        gp.command("set ylabel 'Position (m)'\n");
+        gp.command("set grid\n");
+        gp.command("set key top left\n");
+        gp.command("plot " + series + " using 1:2 with linespoints pt 7 ps 1.5 lc rgb 'blue' title 'x(t)'\n");
+        gp.data(t, x);
 
         // График 2: Скорость
-        script << "# Plot 2: Velocity\n";
-        script << "set title 'Velocity vs Time'\n";
-        script << "set xlabel 'Time (s)'\n";
-        script << "set ylabel 'Velocity (m/s)'\n";
-        script << "set grid\n";
-        script << "set key top left\n";
-        script << "plot 'velocity_data.txt' using 1:2 with linespoints pt 9 ps 1.5 lc rgb 'red' title 'v(t)'\n\n";
+        gp.command("set title 'Velocity vs Time'\n");
+        gp.command("set ylabel 'Velocity (m/s)'\n");
+        gp.command("plot " + series + " using 1:2 with linespoints pt 9 ps 1.5 lc rgb 'red' title 'v(t)'\n");
+        gp.data(t, v);
 
         // График 3: Ускорение
-        script << "# Plot 3: Acceleration\n";
-        script << "set title 'Acceleration vs Time'\n";
-        script << "set xlabel 'Time (s)'\n";
-        script << "set ylabel 'Acceleration (m/s²)'\n";
-        script << "set grid\n";
-        script << "set key top left\n";
-        script << "plot 'acceleration_data.txt' using 1:2 with linespoints pt 5 ps 1.5 lc rgb 'green' title 'a(t)', \\\n";
-        script << "     0 title '' lc rgb 'black'  # Zero line\n";
-
-        script << "unset multiplot\n";
-        script << "pause mouse\n";
-        script.close();
-
-        cout << "\n=== Created GNUPlot Script ===" << endl;
-        cout << "File: plot_motion.gp" << endl;
+        gp.command("set title 'Acceleration vs Time'\n");
+        gp.command("set ylabel 'Acceleration (m/s²)'\n");
+        gp.command("plot " + series + " using 1:2 with linespoints pt 5 ps 1.5 lc rgb 'green' title 'a(t)', "
+                   "0 title '' lc rgb 'black'\n");
+        gp.data(t, a);
+        gp.command("unset multiplot\n");
+
+        cout << "\n=== GNUPlot Plot ===" << endl;
+        cout << "File: plot_motion.png" << endl;
         cout << "\nThe plot shows 3 graphs:" << endl;
         cout << "1. Position vs time (blue)" << endl;
         cout << "2. Velocity vs time (red)" << endl;
         cout << "3. Acceleration vs time (green)" << endl;
-
-        // Запускаем GNUPlot
-        cout << "\n=== Launching Plot ===" << endl;
-        int result = system("gnuplot -p plot_motion.gp 2>/dev/null");
-        if (result != 0) {
-            cout << "Could not launch GNUPlot automatically." << endl;
-            cout << "Please run manually: gnuplot -p plot_motion.gp" << endl;
-        }
     }
 };
 
@@ -250,10 +222,7 @@ int main() {
     cout << "\nFiles created:" << endl;
     cout << "  motion.csv           - Original position data" << endl;
     cout << "  motion_processed.csv - Processed data (t,x,v,a)" << endl;
-    cout << "  position_data.txt    - Position for GNUPlot" << endl;
-    cout << "  velocity_data.txt    - Velocity for GNUPlot" << endl;
-    cout << "  acceleration_data.txt- Acceleration for GNUPlot" << endl;
-    cout << "  plot_motion.gp       - GNUPlot script with 3 plots" << endl;
+    cout << "  plot_motion.png      - GNUPlot plot with 3 graphs" << endl;
 
     return 0;
 }
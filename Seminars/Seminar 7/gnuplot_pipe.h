@@ -0,0 +1,104 @@
+// Plotting backend shared by the Seminar 7 tasks: one gnuplot process fed
+// through a pipe. Data goes inline in gnuplot's binary format, so a plot
+// needs no temporary data files, no .gp script and no extra process; any
+// number of plots can go through the same pipe.
+//
+//     GnuplotPipe gp;
+//     gp.output("plot.png");
+//     gp.command("plot " + GnuplotPipe::binarySource(t.size(), 2) + " using 1:2 with lines\n");
+//     gp.data(t, x);
+#ifndef GNUPLOT_PIPE_H
+#define GNUPLOT_PIPE_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define GNUPLOT_POPEN _popen
+#define GNUPLOT_PCLOSE _pclose
+#define GNUPLOT_PIPE_MODE "wb"
+#define GNUPLOT_NULL_DEVICE "NUL"
+#else
+#define GNUPLOT_POPEN popen
+#define GNUPLOT_PCLOSE pclose
+#define GNUPLOT_PIPE_MODE "w"
+#define GNUPLOT_NULL_DEVICE "/dev/null"
+#endif
+
+// popen starts a shell even when gnuplot is missing, so look for it once
+inline bool gnuplot_available() {
+    static const bool available =
+        std::system("gnuplot --version > " GNUPLOT_NULL_DEVICE " 2>&1") == 0;
+    return available;
+}
+
+class GnuplotPipe {
+private:
+    FILE* pipe;
+    std::vector<double> records;
+
+    GnuplotPipe(const GnuplotPipe&);
+    GnuplotPipe& operator=(const GnuplotPipe&);
+
+public:
+    // persist: keep interactive plot windows open after the pipe is closed
+    explicit GnuplotPipe(bool persist = false)
+        : pipe(GNUPLOT_POPEN(persist ? "gnuplot -persist" : "gnuplot", GNUPLOT_PIPE_MODE)) {
+        if (!pipe) throw std::runtime_error("cannot start gnuplot");
+    }
+
+    // Waits for gnuplot to finish the last plot
+    ~GnuplotPipe() {
+        std::fputs("unset output\nexit\n", pipe);
+        GNUPLOT_PCLOSE(pipe);
+    }
+
+    // Script text, as it would appear in a .gp file
+    void command(const std::string& text) {
+        std::fputs(text.c_str(), pipe);
+    }
+
+    // Headless output: svg for a .svg file name, png otherwise; enhanced
+    // turns on gnuplot's markup (^ and _ for super- and subscripts) in text
+    void output(const std::string& file, int width = 900, int height = 600, bool enhanced = false) {
+        bool svg = file.size() >= 4 && file.compare(file.size() - 4, 4, ".svg") == 0;
+        std::fprintf(pipe, "set terminal %s size %d,%d%s\nset output '%s'\n",
+                     svg ? "svg" : "png", width, height, enhanced ? " enhanced" : "", file.c_str());
+    }
+
+    // Data source for one plot element: n records of `columns` doubles,
+    // sent with data() after the plot command, in the order of the elements
+    static std::string binarySource(size_t n, int columns) {
+        std::string format;
+        for (int c = 0; c < columns; c++) format += "%float64";
+        return "'-' binary record=" + std::to_string(n) + " format='" + format + "'";
+    }
+
+    // n records of `columns` doubles, stored record after record
+    void data(const double* values, size_t n, int columns) {
+        std::fwrite(values, sizeof(double) * columns, n, pipe);
+    }
+
+    // n records (x(k), y(k)), for points that aren't stored as two vectors
+    template <class X, class Y>
+    void data(size_t n, X x, Y y) {
+        records.resize(2 * n);
+        for (size_t k = 0; k < n; k++) {
+            records[2 * k] = x(k);
+            records[2 * k + 1] = y(k);
+        }
+        data(records.data(), n, 2);
+    }
+
+    // Records (x[k], y[k])
+    void data(const std::vector<double>& x, const std::vector<double>& y) {
+        data(x.size(), [&](size_t k) { return x[k]; }, [&](size_t k) { return y[k]; });
+    }
+
+    void flush() { std::fflush(pipe); }
+};
+
+#endif